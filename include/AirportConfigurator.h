@@ -1,12 +1,17 @@
 #pragma once
 #include "Navdata.h"
+#include "SharedSnapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 namespace RouteParser {
@@ -16,6 +21,40 @@ struct AirportRunways {
     std::vector<std::string> arrRunways;
 };
 
+// Suggested (runway, procedure) of one airport, keyed by the first route fix for
+// SIDs and the last one for STARs. Immutable, shared by the configurations of
+// which neither the airport's runways nor its procedures changed.
+struct AirportSuggestions {
+    // Procedures the tables were built from, nullptr when the airport had none
+    std::shared_ptr<const AirportProcedures> procedures;
+    std::string defaultDepRunway;
+    std::string defaultArrRunway;
+    std::unordered_map<std::string, std::pair<std::string, ProcedurePtr>> sidByFix;
+    std::unordered_map<std::string, std::pair<std::string, ProcedurePtr>> starByFix;
+};
+
+// Active runways with the suggestions derived from them. Immutable, replaced as a
+// whole when the runways or the procedures change.
+struct RunwayConfiguration {
+    // Bumped by every runway update
+    uint64_t runwayVersion = 0;
+    uint64_t proceduresVersion = 0;
+    std::unordered_map<std::string, AirportRunways> runways;
+    std::unordered_map<std::string, std::shared_ptr<const AirportSuggestions>> suggestions;
+};
+
+// Runways of one airport, viewed in place inside the configuration it keeps alive
+struct RunwayView {
+    std::shared_ptr<const RunwayConfiguration> owner;
+    std::span<const std::string> runways;
+
+    auto begin() const { return runways.begin(); }
+    auto end() const { return runways.end(); }
+    size_t size() const { return runways.size(); }
+    bool empty() const { return runways.empty(); }
+    const std::string& operator[](size_t index) const { return runways[index]; }
+};
+
 class AirportConfigurator {
 public:
     AirportConfigurator() {};
@@ -24,116 +63,174 @@ public:
     inline void UpdateAirportRunways(
         const std::unordered_map<std::string, AirportRunways>& airportRunways)
     {
-        std::lock_guard<std::mutex> lock(airportRunwaysMutex_);
-        runways_ = airportRunways;
+        std::lock_guard<std::mutex> lock(rebuildMutex_);
+        configuration_.store(
+            BuildConfiguration(airportRunways, ++runwayVersion_, *configuration_.load()));
+    }
+
+    uint64_t GetRunwayVersion() const { return configuration_.load()->runwayVersion; }
+
+    // Suggestion tables of one airport, nullptr if it has no active runways
+    std::shared_ptr<const AirportSuggestions> GetAirportSuggestions(
+        const std::string& icao) const
+    {
+        auto configuration = GetConfiguration();
+        auto it = configuration->suggestions.find(icao);
+        return it != configuration->suggestions.end() ? it->second : nullptr;
     }
 
-    std::vector<std::string> GetDepartureRunways(const std::string& icao) const
+    RunwayView GetDepartureRunways(const std::string& icao) const
     {
-        std::lock_guard<std::mutex> lock(airportRunwaysMutex_);
-        auto it = runways_.find(icao);
-        if (it != runways_.end()) {
-            return it->second.depRunways;
+        auto configuration = configuration_.load();
+        auto it = configuration->runways.find(icao);
+        if (it != configuration->runways.end()) {
+            return { std::move(configuration), it->second.depRunways };
         }
         return {};
     }
 
-    std::vector<std::string> GetArrivalRunways(const std::string& icao) const
+    RunwayView GetArrivalRunways(const std::string& icao) const
     {
-        std::lock_guard<std::mutex> lock(airportRunwaysMutex_);
-        auto it = runways_.find(icao);
-        if (it != runways_.end()) {
-            return it->second.arrRunways;
+        auto configuration = configuration_.load();
+        auto it = configuration->runways.find(icao);
+        if (it != configuration->runways.end()) {
+            return { std::move(configuration), it->second.arrRunways };
         }
         return {};
     }
-    std::optional<std::pair<std::string, std::optional<Procedure>>> FindBestSID(
+
+    std::optional<std::pair<std::string, ProcedurePtr>> FindBestSID(
         const std::string& icao, const std::vector<std::string>& waypoints) const
     {
         if (waypoints.empty()) {
             return std::nullopt;
         }
 
-        auto depRunways = GetDepartureRunways(icao);
-        if (depRunways.empty()) {
+        const auto suggestions = GetAirportSuggestions(icao);
+        if (!suggestions || suggestions->defaultDepRunway.empty()) {
             return std::nullopt;
         }
 
-        // Create a set for O(1) runway lookups
-        std::unordered_set<std::string> activeRunways(
-            depRunways.begin(), depRunways.end());
-        const auto& firstWaypoint = waypoints[0];
-        const auto& procedures = NavdataObject::GetProcedures();
-        auto airportProcedures = NavdataObject::GetProceduresByAirport(icao);
-
-        // Find the first matching procedure
-        for (size_t idx : airportProcedures) {
-            const auto& procedure = procedures[idx];
-
-            // Fast filters
-            if (procedure.type != PROCEDURE_SID
-                || !activeRunways.count(procedure.runway)) {
-                continue;
-            }
-
-            // Check if the first waypoint is in this procedure
-            for (const auto& procWpt : procedure.waypoints) {
-                if (procWpt.getIdentifier() == firstWaypoint) {
-                    // Direct return on first match for efficiency
-                    return std::make_pair(procedure.runway, procedure);
-                }
-            }
+        auto suggestion = suggestions->sidByFix.find(waypoints.front());
+        if (suggestion != suggestions->sidByFix.end()) {
+            return suggestion->second;
         }
 
         // No match found
-        return std::make_pair(depRunways[0], std::nullopt);
+        return std::make_pair(suggestions->defaultDepRunway, ProcedurePtr {});
     }
 
-    std::optional<std::pair<std::string, std::optional<Procedure>>> FindBestSTAR(
+    std::optional<std::pair<std::string, ProcedurePtr>> FindBestSTAR(
         const std::string& icao, const std::vector<std::string>& waypoints) const
     {
         if (waypoints.empty()) {
             return std::nullopt;
         }
 
-        auto arrRunways = GetArrivalRunways(icao);
-        if (arrRunways.empty()) {
+        const auto suggestions = GetAirportSuggestions(icao);
+        if (!suggestions || suggestions->defaultArrRunway.empty()) {
             return std::nullopt;
         }
 
-        // Create a set for O(1) runway lookups
-        std::unordered_set<std::string> activeRunways(
-            arrRunways.begin(), arrRunways.end());
-        const auto& lastWaypoint = waypoints.back();
-        const auto& procedures = NavdataObject::GetProcedures();
-        auto airportProcedures = NavdataObject::GetProceduresByAirport(icao);
+        auto suggestion = suggestions->starByFix.find(waypoints.back());
+        if (suggestion != suggestions->starByFix.end()) {
+            return suggestion->second;
+        }
+
+        // No match found
+        return std::make_pair(suggestions->defaultArrRunway, ProcedurePtr {});
+    }
+
+private:
+    // Current configuration, with its suggestions brought up to date first if the
+    // procedures changed since. One reader rebuilds, the others wait for it.
+    std::shared_ptr<const RunwayConfiguration> GetConfiguration() const
+    {
+        auto configuration = configuration_.load();
+        if (configuration->proceduresVersion == NavdataObject::GetProceduresVersion()) {
+            return configuration;
+        }
+
+        std::lock_guard<std::mutex> lock(rebuildMutex_);
+        configuration = configuration_.load();
+        if (configuration->proceduresVersion == NavdataObject::GetProceduresVersion()) {
+            return configuration;
+        }
+        configuration = BuildConfiguration(
+            configuration->runways, configuration->runwayVersion, *configuration);
+        configuration_.store(configuration);
+        return configuration;
+    }
 
-        // Find the first matching procedure
-        for (size_t idx : airportProcedures) {
-            const auto& procedure = procedures[idx];
+    // Only the airports whose runways or procedures differ from previous are rebuilt
+    static std::shared_ptr<const RunwayConfiguration> BuildConfiguration(
+        const std::unordered_map<std::string, AirportRunways>& airportRunways,
+        uint64_t runwayVersion, const RunwayConfiguration& previous)
+    {
+        auto configuration = std::make_shared<RunwayConfiguration>();
+        configuration->runwayVersion = runwayVersion;
+        // Read first, a change made while building is picked up by the next read
+        configuration->proceduresVersion = NavdataObject::GetProceduresVersion();
+        configuration->runways = airportRunways;
+
+        for (const auto& [icao, runways] : airportRunways) {
+            auto chunk = NavdataObject::GetAirportProcedures(icao);
+            auto previousRunways = previous.runways.find(icao);
+            auto previousSuggestions = previous.suggestions.find(icao);
+            if (previousRunways != previous.runways.end()
+                && previousSuggestions != previous.suggestions.end()
+                && previousSuggestions->second->procedures == chunk
+                && previousRunways->second.depRunways == runways.depRunways
+                && previousRunways->second.arrRunways == runways.arrRunways) {
+                configuration->suggestions.emplace(icao, previousSuggestions->second);
+                continue;
+            }
+            configuration->suggestions.emplace(
+                icao, BuildAirportSuggestions(runways, std::move(chunk)));
+        }
+        return configuration;
+    }
+
+    static std::shared_ptr<const AirportSuggestions> BuildAirportSuggestions(
+        const AirportRunways& runways, std::shared_ptr<const AirportProcedures> chunk)
+    {
+        auto suggestions = std::make_shared<AirportSuggestions>();
+        suggestions->procedures = std::move(chunk);
+        if (!runways.depRunways.empty()) {
+            suggestions->defaultDepRunway = runways.depRunways[0];
+        }
+        if (!runways.arrRunways.empty()) {
+            suggestions->defaultArrRunway = runways.arrRunways[0];
+        }
+        if (!suggestions->procedures) {
+            return suggestions;
+        }
 
-            // Fast filters
-            if (procedure.type != PROCEDURE_STAR
-                || !activeRunways.count(procedure.runway)) {
+        // In procedure order, so the first procedure on an active runway going
+        // through a fix wins
+        for (const auto& procedure : suggestions->procedures->procedures) {
+            const auto& active
+                = procedure->type == PROCEDURE_SID ? runways.depRunways : runways.arrRunways;
+            if (std::find(active.begin(), active.end(), procedure->runway) == active.end()) {
                 continue;
             }
 
-            // Check if the last waypoint is in this procedure
-            for (const auto& procWpt : procedure.waypoints) {
-                if (procWpt.getIdentifier() == lastWaypoint) {
-                    // Direct return on first match for efficiency
-                    return std::make_pair(procedure.runway, procedure);
-                }
+            auto& byFix = procedure->type == PROCEDURE_SID ? suggestions->sidByFix
+                                                           : suggestions->starByFix;
+            for (const auto& waypoint : procedure->waypoints) {
+                byFix.try_emplace(waypoint.getIdentifier(), procedure->runway, procedure);
             }
         }
-
-        // No match found
-        return std::make_pair(arrRunways[0], std::nullopt);
+        return suggestions;
     }
 
-private:
-    std::unordered_map<std::string, AirportRunways> runways_;
-    mutable std::mutex airportRunwaysMutex_;
+    std::atomic<uint64_t> runwayVersion_ = 0;
+    // Serialises publishing, readers only take it to bring stale suggestions up to date
+    mutable std::mutex rebuildMutex_;
+    // Readers never lock on an up to date configuration, writers publish a whole new one
+    mutable SharedSnapshot<const RunwayConfiguration> configuration_ {
+        std::make_shared<const RunwayConfiguration>()
+    };
 };
 
-} // namespace RouteParser
\ No newline at end of file
+} // namespace RouteParser
@@ -2,9 +2,12 @@
 #include <string>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include <memory>
+#include <mutex>
 #include <SQLiteCpp/SQLiteCpp.h>
 #include "types/Airport.h"
+#include "types/MemoryUsage.h"
 
 namespace RouteParser
 {
@@ -18,15 +21,17 @@ namespace RouteParser
         AirportNetwork(const AirportNetwork &) = delete;
         AirportNetwork &operator=(const AirportNetwork &) = delete;
 
-        AirportNetwork(AirportNetwork &&) noexcept = default;
-        AirportNetwork &operator=(AirportNetwork &&) noexcept = default;
-
         [[nodiscard]] bool isInitialized() const noexcept { return db_ != nullptr && isInitialized_; }
 
         [[nodiscard]] std::optional<Airport> findAirport(const std::string &ident);
 
         void clearCache() noexcept;
 
+        [[nodiscard]] MemoryUsageEntry memoryUsage() const;
+
+        // Identifiers of the cached airports
+        [[nodiscard]] std::vector<std::string> cachedKeys() const;
+
         bool initialize(const std::string &dbPath = "");
 
     private:
@@ -38,6 +43,8 @@ namespace RouteParser
         bool useCache_;
         bool isInitialized_{false};
         std::unique_ptr<SQLite::Database> db_;
+        // Lookups may run on several threads
+        mutable std::mutex cacheMutex_;
         std::unordered_map<std::string, Airport> cache_;
     };
 
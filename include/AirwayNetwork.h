@@ -2,20 +2,32 @@
 #define AIRWAYNETWORK_H
 
 #include <SQLiteCpp/SQLiteCpp.h>
+#include <memory>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include "ConnectionPool.h"
 #include "types/Airway.h"
+#include "types/MemoryUsage.h"
 #include "types/ParsingError.h"
 
 namespace RouteParser
 {
 
     class NavdataObject;
+    struct AirwayGraph;
     class AirwayNetwork
     {
     private:
-        SQLite::Database db;
+        // Lookups and prefetches may run on several threads, each leases its own
+        std::unique_ptr<ConnectionPool> connections;
+        // Every airway of the database, loaded once, it never changes
+        std::unordered_set<std::string> airwayNames;
+        // Segments of the airways looked up so far, kept for good
+        mutable std::shared_mutex cacheMutex;
+        std::unordered_map<std::string, std::shared_ptr<const AirwayGraph>> graphCache;
 
     public:
         AirwayNetwork(const std::string &dbPath);
@@ -27,7 +39,13 @@ namespace RouteParser
             std::shared_ptr<NavdataObject> navdata);
         bool airwayExists(const std::string &airwayName);
 
+        // Loads the segments of the airway into the cache, if it exists
+        void prefetchAirway(const std::string &airwayName);
+
+        MemoryUsageEntry memoryUsage() const;
+
     private:
+        std::shared_ptr<const AirwayGraph> airwayGraph(const std::string &airway);
         std::string join(const std::vector<std::string> &vec, const std::string &delimiter);
         bool isInitialized = false;
     };
@@ -0,0 +1,95 @@
+#pragma once
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @class ConnectionPool
+ * @brief Read-only connections to one database, each used by a single thread at once.
+ *
+ * A connection serialises the statements run on it, so lookups made at the same time,
+ * such as those of the prefetch workers and the parse, each lease their own. Connections
+ * are opened on demand and kept for later leases, there are never more than the threads
+ * that queried the database at once.
+ */
+class ConnectionPool {
+public:
+    // Hands its connection back to the pool when destroyed
+    class Lease {
+    public:
+        Lease(ConnectionPool& pool, std::unique_ptr<SQLite::Database> connection)
+            : pool(&pool)
+            , connection(std::move(connection))
+        {
+        }
+
+        Lease(Lease&& other) noexcept
+            : pool(other.pool)
+            , connection(std::move(other.connection))
+        {
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&&) = delete;
+
+        ~Lease()
+        {
+            if (connection) {
+                pool->Release(std::move(connection));
+            }
+        }
+
+        SQLite::Database& operator*() const { return *connection; }
+        SQLite::Database* operator->() const { return connection.get(); }
+
+    private:
+        ConnectionPool* pool;
+        std::unique_ptr<SQLite::Database> connection;
+    };
+
+    // first, if any, is the connection the database was validated with
+    explicit ConnectionPool(
+        std::string path, std::unique_ptr<SQLite::Database> first = nullptr)
+        : path(std::move(path))
+    {
+        if (first) {
+            idle.push_back(std::move(first));
+        }
+    }
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Throws SQLite::Exception when a new connection cannot be opened
+    Lease Acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle.empty()) {
+                auto connection = std::move(idle.back());
+                idle.pop_back();
+                return Lease(*this, std::move(connection));
+            }
+        }
+        return Lease(*this, std::make_unique<SQLite::Database>(path, SQLite::OPEN_READONLY));
+    }
+
+private:
+    void Release(std::unique_ptr<SQLite::Database> connection)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(connection));
+    }
+
+    const std::string path;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SQLite::Database>> idle;
+};
+
+} // namespace RouteParser
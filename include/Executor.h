@@ -0,0 +1,54 @@
+#pragma once
+#include "ThreadPool.h"
+#include <coroutine>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+namespace RouteParser {
+
+/**
+ * @class Executor
+ * @brief Where asynchronous parses run their blocking work, implemented by the
+ * caller to plug in its own event loop or pool.
+ */
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    // Runs the work later, on a thread of the executor's choosing
+    virtual void Post(std::function<void()> work) = 0;
+};
+
+// Executor running work on a ThreadPool of its own
+class ThreadPoolExecutor : public Executor {
+public:
+    // 0 for one thread per hardware thread
+    explicit ThreadPoolExecutor(size_t threadCount = 0)
+        : pool(threadCount)
+    {
+    }
+
+    void Post(std::function<void()> work) override { pool.Post(std::move(work)); }
+
+private:
+    ThreadPool pool;
+};
+
+// Awaitable moving the coroutine onto the executor
+inline auto ScheduleOn(Executor& executor)
+{
+    struct Schedule {
+        Executor& executor;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            executor.Post([handle]() { handle.resume(); });
+        }
+        void await_resume() const noexcept { }
+    };
+    return Schedule { executor };
+}
+
+} // namespace RouteParser
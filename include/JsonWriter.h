@@ -0,0 +1,362 @@
+#pragma once
+#include "types/ParsedRoute.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @class JsonWriter
+ * @brief Writes JSON straight into a caller supplied string, without a DOM.
+ *
+ * The output is byte for byte what nlohmann::json::dump() gives for the same values:
+ * no whitespace, strings escaped the same way and doubles formatted with the same
+ * shortest round trip algorithm. Keys are written as given, callers write them in
+ * the sorted order of nlohmann's default object. Strings are expected to be valid
+ * UTF-8. Nesting is limited to 64 levels.
+ */
+class JsonWriter {
+public:
+    // Appends to out, reusing its capacity
+    explicit JsonWriter(std::string& out)
+        : out(out)
+    {
+    }
+
+    void BeginObject()
+    {
+        Separate();
+        out.push_back('{');
+        Push();
+    }
+
+    void EndObject()
+    {
+        depth--;
+        out.push_back('}');
+    }
+
+    void BeginArray()
+    {
+        Separate();
+        out.push_back('[');
+        Push();
+    }
+
+    void EndArray()
+    {
+        depth--;
+        out.push_back(']');
+    }
+
+    // Keys are plain identifiers, written without escaping
+    void Key(std::string_view key)
+    {
+        Separate();
+        out.push_back('"');
+        out.append(key);
+        out.append("\":");
+        afterKey = true;
+    }
+
+    void Null()
+    {
+        Separate();
+        out.append("null");
+    }
+
+    void Int(int64_t value)
+    {
+        Separate();
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+
+    void Double(double value)
+    {
+        Separate();
+        if (!std::isfinite(value)) {
+            out.append("null");
+            return;
+        }
+        // nlohmann's own Grisu2 formatting
+        char buffer[64];
+        const char* end = nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, static_cast<size_t>(end - buffer));
+    }
+
+    void String(std::string_view value)
+    {
+        Separate();
+        out.push_back('"');
+        size_t run = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            const auto c = static_cast<unsigned char>(value[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            out.append(value.data() + run, i - run);
+            run = i + 1;
+            switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\b':
+                out.append("\\b");
+                break;
+            case '\f':
+                out.append("\\f");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            default: {
+                static constexpr char hex[] = "0123456789abcdef";
+                const char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                out.append(escaped, sizeof(escaped));
+            }
+            }
+        }
+        out.append(value.data() + run, value.size() - run);
+        out.push_back('"');
+    }
+
+private:
+    // Comma before every value but the first of its container, none after a key
+    void Separate()
+    {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (depth == 0) {
+            return;
+        }
+        const uint64_t bit = uint64_t { 1 } << (depth - 1);
+        if (started & bit) {
+            out.push_back(',');
+        }
+        started |= bit;
+    }
+
+    void Push()
+    {
+        depth++;
+        started &= ~(uint64_t { 1 } << (depth - 1));
+    }
+
+    std::string& out;
+    // Whether each open container has a value yet, by depth
+    uint64_t started = 0;
+    int depth = 0;
+    bool afterKey = false;
+};
+
+// Schema of the parse result, members in nlohmann's sorted key order
+
+inline void WriteJson(JsonWriter& writer, const std::string& value) { writer.String(value); }
+
+template <typename T>
+inline void WriteJson(JsonWriter& writer, const std::optional<T>& value)
+{
+    if (value) {
+        WriteJson(writer, *value);
+    } else {
+        writer.Null();
+    }
+}
+
+template <typename T>
+inline void WriteJson(JsonWriter& writer, const std::vector<T>& values)
+{
+    writer.BeginArray();
+    for (const auto& value : values) {
+        WriteJson(writer, value);
+    }
+    writer.EndArray();
+}
+
+inline void WriteJson(JsonWriter& writer, int value) { writer.Int(value); }
+
+inline void WriteJson(JsonWriter& writer, const erkir::spherical::Point& position)
+{
+    writer.BeginArray();
+    writer.Double(position.latitude().degrees());
+    writer.Double(position.longitude().degrees());
+    writer.EndArray();
+}
+
+inline void WriteJson(JsonWriter& writer, const Waypoint& waypoint)
+{
+    writer.BeginObject();
+    writer.Key("frequencyHz");
+    writer.Int(waypoint.getFrequencyHz());
+    writer.Key("identifier");
+    writer.String(waypoint.getIdentifier());
+    writer.Key("name");
+    writer.String(waypoint.getName());
+    writer.Key("position");
+    WriteJson(writer, waypoint.getPosition());
+    writer.Key("type");
+    writer.Int(waypoint.getType());
+    writer.EndObject();
+}
+
+inline void WriteJson(
+    JsonWriter& writer, const RouteWaypoint::PlannedAltitudeAndSpeed& planned)
+{
+    writer.BeginObject();
+    writer.Key("altitudeUnit");
+    writer.Int(planned.altitudeUnit);
+    writer.Key("plannedAltitude");
+    WriteJson(writer, planned.plannedAltitude);
+    writer.Key("plannedSpeed");
+    WriteJson(writer, planned.plannedSpeed);
+    writer.Key("speedUnit");
+    writer.Int(planned.speedUnit);
+    writer.EndObject();
+}
+
+inline void WriteJson(JsonWriter& writer, const RouteWaypoint& waypoint)
+{
+    writer.BeginObject();
+    writer.Key("flightRule");
+    writer.Int(waypoint.GetFlightRule());
+    writer.Key("frequencyHz");
+    writer.Int(waypoint.getFrequencyHz());
+    writer.Key("identifier");
+    writer.String(waypoint.getIdentifier());
+    writer.Key("name");
+    writer.String(waypoint.getName());
+    writer.Key("plannedPosition");
+    WriteJson(writer, waypoint.m_plannedPosition);
+    writer.Key("position");
+    WriteJson(writer, waypoint.getPosition());
+    writer.Key("type");
+    writer.Int(waypoint.getType());
+    writer.EndObject();
+}
+
+inline void WriteJson(JsonWriter& writer, const ParsedRouteSegment& segment)
+{
+    writer.BeginObject();
+    writer.Key("airway");
+    writer.String(segment.airway);
+    writer.Key("from");
+    WriteJson(writer, segment.from);
+    writer.Key("heading");
+    writer.Int(segment.heading);
+    writer.Key("minimumLevel");
+    writer.Int(segment.minimumLevel);
+    writer.Key("to");
+    WriteJson(writer, segment.to);
+    writer.EndObject();
+}
+
+inline void WriteJson(JsonWriter& writer, const ParsingError& error)
+{
+    writer.BeginObject();
+    writer.Key("level");
+    writer.Int(error.level);
+    writer.Key("message");
+    writer.String(error.GetMessage());
+    writer.Key("token");
+    writer.String(error.token);
+    writer.Key("tokenIndex");
+    writer.Int(error.tokenIndex);
+    writer.Key("type");
+    writer.Int(error.type);
+    writer.EndObject();
+}
+
+inline void WriteJson(JsonWriter& writer, const ProcedurePtr& procedure)
+{
+    if (!procedure) {
+        writer.Null();
+        return;
+    }
+    writer.BeginObject();
+    writer.Key("icao");
+    writer.String(procedure->icao);
+    writer.Key("name");
+    writer.String(procedure->name);
+    writer.Key("runway");
+    writer.String(procedure->runway);
+    writer.Key("type");
+    writer.Int(procedure->type);
+    writer.Key("waypoints");
+    WriteJson(writer, procedure->waypoints);
+    writer.EndObject();
+}
+
+inline void WriteJson(JsonWriter& writer, const ParsedRoute& route)
+{
+    writer.BeginObject();
+    writer.Key("SID");
+    WriteJson(writer, route.SID);
+    writer.Key("STAR");
+    WriteJson(writer, route.STAR);
+    writer.Key("arrivalRunway");
+    WriteJson(writer, route.arrivalRunway);
+    writer.Key("departureRunway");
+    WriteJson(writer, route.departureRunway);
+    writer.Key("errors");
+    writer.BeginArray();
+    for (const auto& error : route.errors) {
+        WriteJson(writer, error);
+    }
+    writer.EndArray();
+    writer.Key("explicitSegments");
+    WriteJson(writer, route.GetExplicitSegments());
+    writer.Key("explicitWaypoints");
+    WriteJson(writer, route.GetExplicitWaypoints());
+    writer.Key("rawRoute");
+    writer.String(route.rawRoute);
+    writer.Key("segments");
+    WriteJson(writer, route.segments);
+    writer.Key("sidConnectionWaypoint");
+    WriteJson(writer, route.GetSidConnectionWaypoint());
+    writer.Key("starConnectionWaypoint");
+    WriteJson(writer, route.GetStarConnectionWaypoint());
+    writer.Key("suggestedArrivalRunway");
+    WriteJson(writer, route.suggestedArrivalRunway);
+    writer.Key("suggestedDepartureRunway");
+    WriteJson(writer, route.suggestedDepartureRunway);
+    writer.Key("suggestedSID");
+    WriteJson(writer, route.suggestedSID);
+    writer.Key("suggestedSTAR");
+    WriteJson(writer, route.suggestedSTAR);
+    writer.Key("totalTokens");
+    writer.Int(route.totalTokens);
+    writer.Key("waypoints");
+    WriteJson(writer, route.waypoints);
+    writer.EndObject();
+}
+
+/**
+ * @brief Serialises a parse result, same output as nlohmann::json(route).dump().
+ * @param out The buffer the JSON is appended to.
+ */
+inline void WriteParsedRouteJson(const ParsedRoute& route, std::string& out)
+{
+    JsonWriter writer(out);
+    WriteJson(writer, route);
+}
+
+} // namespace RouteParser
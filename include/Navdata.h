@@ -3,66 +3,247 @@
 #include "AirwayNetwork.h"
 #include "Log.h"
 #include "RunwayNetwork.h"
+#include "SharedSnapshot.h"
 #include "Utils.h"
 #include "WaypointNetwork.h"
+#include "absl/container/flat_hash_map.h"
+#include "types/MemoryUsage.h"
 #include "types/Procedure.h"
 #include "types/Waypoint.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 namespace RouteParser {
 
+// (procedure type, runway or fix identifier)
+using ProcedureIndexKey = std::pair<ProcedureType, std::string>;
+
+// All procedures of one airport with their indices. Built once and never modified,
+// an update replaces the whole chunk so readers holding the old one stay consistent.
+struct AirportProcedures {
+    std::vector<ProcedurePtr> procedures;
+    std::unordered_map<std::string, std::vector<ProcedurePtr>> byName;
+    absl::flat_hash_map<ProcedureIndexKey, std::vector<ProcedurePtr>> byRunway;
+    absl::flat_hash_map<ProcedureIndexKey, std::vector<ProcedurePtr>> byFix;
+
+    static std::shared_ptr<const AirportProcedures> Build(
+        std::vector<ProcedurePtr> airportProcedures)
+    {
+        auto chunk = std::make_shared<AirportProcedures>();
+        chunk->procedures = std::move(airportProcedures);
+        for (const auto& procedure : chunk->procedures) {
+            chunk->byName[procedure->name].push_back(procedure);
+            chunk->byRunway[{ procedure->type, procedure->runway }].push_back(procedure);
+
+            // Inverted index, a fix listed twice in a procedure is only indexed once
+            for (const auto& waypoint : procedure->waypoints) {
+                auto& fixProcedures
+                    = chunk->byFix[{ procedure->type, waypoint.getIdentifier() }];
+                if (fixProcedures.empty() || fixProcedures.back() != procedure) {
+                    fixProcedures.push_back(procedure);
+                }
+            }
+        }
+        return chunk;
+    }
+};
+
 class NavdataObject {
 public:
     NavdataObject();
 
     static void SetProcedures(const std::vector<Procedure>& newProcedures)
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-        procedures = newProcedures;
+        // Procedures are immutable once loaded, parse results share them
+        std::unordered_map<std::string, std::vector<ProcedurePtr>> grouped;
+        std::vector<std::string> airportOrder;
+        for (const auto& procedure : newProcedures) {
+            auto& airportProcedures = grouped[procedure.icao];
+            if (airportProcedures.empty()) {
+                airportOrder.push_back(procedure.icao);
+            }
+            airportProcedures.push_back(std::make_shared<const Procedure>(procedure));
+        }
 
-        // Build the index
-        procedureNameIndex.clear();
-        procedureAirportIndex.clear();
-        for (size_t i = 0; i < procedures.size(); i++) {
-            procedureNameIndex[procedures[i].name].push_back(i);
-            procedureAirportIndex[procedures[i].icao].push_back(i);
+        std::unordered_map<std::string, std::shared_ptr<const AirportProcedures>> chunks;
+        std::unordered_map<std::string, std::vector<std::string>> nameIndex;
+        std::map<uint64_t, std::string> loadOrder;
+        std::unordered_map<std::string, uint64_t> loadPositions;
+        for (const auto& icao : airportOrder) {
+            auto chunk = AirportProcedures::Build(std::move(grouped[icao]));
+            for (const auto& [name, _] : chunk->byName) {
+                nameIndex[name].push_back(icao);
+            }
+            chunks.emplace(icao, std::move(chunk));
+            loadPositions.emplace(icao, loadOrder.size());
+            loadOrder.emplace(loadOrder.size(), icao);
         }
 
-        Log::info("Loaded {} procedures into NavdataObject", procedures.size());
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            airportProcedures = std::move(chunks);
+            procedureNameIndex = std::move(nameIndex);
+            airportLoadOrder = std::move(loadOrder);
+            airportLoadPositions = std::move(loadPositions);
+            nextLoadPosition = airportLoadOrder.size();
+            proceduresVersion++;
+        }
+
+        Log::info("Loaded {} procedures into NavdataObject", newProcedures.size());
     }
 
-    // Fast lookup by name
-    static std::vector<Procedure> GetProceduresByName(const std::string& name)
+    // Replaces the procedures of one airport, leaving every other airport untouched
+    static void UpsertAirportProcedures(
+        const std::string& icao, const std::vector<Procedure>& newProcedures)
     {
+        std::vector<ProcedurePtr> sharedProcedures;
+        sharedProcedures.reserve(newProcedures.size());
+        for (const auto& procedure : newProcedures) {
+            if (procedure.icao != icao) {
+                Log::error("Ignoring procedure {} of {} in update for {}", procedure.name,
+                    procedure.icao, icao);
+                continue;
+            }
+            sharedProcedures.push_back(std::make_shared<const Procedure>(procedure));
+        }
+
+        if (sharedProcedures.empty()) {
+            RemoveAirportProcedures(icao);
+            return;
+        }
+
+        // Built outside the lock, readers keep using the previous chunk meanwhile
+        auto chunk = AirportProcedures::Build(std::move(sharedProcedures));
+
         std::lock_guard<std::mutex> lock(_mutex);
-        std::vector<Procedure> result;
-        auto it = procedureNameIndex.find(name);
-        if (it != procedureNameIndex.end()) {
-            for (size_t idx : it->second) {
-                result.push_back(procedures[idx]);
+        // Names the airport already had keep their place in the name index
+        auto it = airportProcedures.find(icao);
+        if (it != airportProcedures.end()) {
+            RemoveFromNameIndex(icao, *it->second, chunk.get());
+        }
+        for (const auto& [name, _] : chunk->byName) {
+            if (it == airportProcedures.end() || !it->second->byName.contains(name)) {
+                procedureNameIndex[name].push_back(icao);
             }
         }
+        // An updated airport keeps its place in load order, a new one goes last
+        if (airportLoadPositions.try_emplace(icao, nextLoadPosition).second) {
+            airportLoadOrder.emplace(nextLoadPosition++, icao);
+        }
+        Log::info("Loaded {} procedures for {}", chunk->procedures.size(), icao);
+        airportProcedures[icao] = std::move(chunk);
+        proceduresVersion++;
+    }
+
+    static void RemoveAirportProcedures(const std::string& icao)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = airportProcedures.find(icao);
+        if (it == airportProcedures.end()) {
+            return;
+        }
+        RemoveFromNameIndex(icao, *it->second);
+        airportProcedures.erase(it);
+        auto position = airportLoadPositions.find(icao);
+        airportLoadOrder.erase(position->second);
+        airportLoadPositions.erase(position);
+        proceduresVersion++;
+    }
+
+    // Fast lookup by name
+    static std::vector<ProcedurePtr> GetProceduresByName(const std::string& name)
+    {
+        std::vector<std::shared_ptr<const AirportProcedures>> chunks;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = procedureNameIndex.find(name);
+            if (it == procedureNameIndex.end()) {
+                return {};
+            }
+            for (const auto& icao : it->second) {
+                chunks.push_back(airportProcedures.at(icao));
+            }
+        }
+
+        std::vector<ProcedurePtr> result;
+        for (const auto& chunk : chunks) {
+            const auto& named = chunk->byName.at(name);
+            result.insert(result.end(), named.begin(), named.end());
+        }
         return result;
     }
 
     // Fast lookup by airport ICAO
-    static std::vector<size_t> GetProceduresByAirport(const std::string& icao)
+    static std::vector<ProcedurePtr> GetProceduresByAirport(const std::string& icao)
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-        auto it = procedureAirportIndex.find(icao);
-        if (it != procedureAirportIndex.end()) {
+        auto chunk = GetAirportProcedures(icao);
+        return chunk ? chunk->procedures : std::vector<ProcedurePtr> {};
+    }
+
+    // Lookup by airport, procedure type and runway, in procedure order
+    static std::vector<ProcedurePtr> GetProceduresByRunway(
+        const std::string& icao, ProcedureType type, const std::string& runway)
+    {
+        auto chunk = GetAirportProcedures(icao);
+        if (!chunk) {
+            return {};
+        }
+        auto it = chunk->byRunway.find(ProcedureIndexKey { type, runway });
+        if (it != chunk->byRunway.end()) {
             return it->second;
         }
         return {};
     }
 
+    // Lookup of the procedures of an airport and type going through a fix, in
+    // procedure order
+    static std::vector<ProcedurePtr> GetProceduresByFix(
+        const std::string& icao, ProcedureType type, const std::string& fixIdentifier)
+    {
+        auto chunk = GetAirportProcedures(icao);
+        if (!chunk) {
+            return {};
+        }
+        auto it = chunk->byFix.find(ProcedureIndexKey { type, fixIdentifier });
+        if (it != chunk->byFix.end()) {
+            return it->second;
+        }
+        return {};
+    }
+
+    // Consistent snapshot of one airport's procedures, nullptr if it has none
+    static std::shared_ptr<const AirportProcedures> GetAirportProcedures(
+        const std::string& icao)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = airportProcedures.find(icao);
+        if (it != airportProcedures.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    // Bumped on every procedure change, lets callers invalidate derived data
+    static uint64_t GetProceduresVersion() { return proceduresVersion.load(); }
+
+    // Changes whenever anything a parse depends on is loaded or replaced
+    static uint64_t GetNavdataVersion()
+    {
+        return proceduresVersion.load() + dataVersion.load();
+    }
+
     static void LoadAirwayNetwork(std::string airwaysFilePath);
 
     static void LoadWaypoints(std::string waypointsFilePath);
@@ -74,6 +255,20 @@ public:
     static void LoadNseWaypoints(
         const std::vector<Waypoint>& waypoints, const std::string& providerName);
 
+    // Waypoints of a navdata or airways database, read from a navdata image mapped
+    // by every process instead of the database. The image is built first when it is
+    // missing or older than the database.
+    static void LoadWaypointImage(
+        std::string waypointsFilePath, std::string imagePath, bool airwaysDb = false);
+
+    /**
+     * @brief Estimates the memory held by the loaded navdata: the waypoint cache and
+     * providers, the airway, airport and runway caches, procedures and their indices,
+     * waypoints created while parsing and SQLite, including the in-memory airway
+     * database.
+     */
+    static std::vector<MemoryUsageEntry> MemoryUsage();
+
     static const std::unordered_map<std::string, Waypoint> GetWaypoints()
     {
         std::lock_guard<std::mutex> lock(_mutex);
@@ -82,22 +277,44 @@ public:
 
     static const std::shared_ptr<WaypointNetwork> GetWaypointNetwork()
     {
-        return waypointNetwork;
+        return waypointNetwork.load();
     }
 
+    // Lookups still running keep the network they loaded until they are done
     static void Reset()
     {
-        if (waypointNetwork) {
-            waypointNetwork = std::make_shared<WaypointNetwork>();
+        {
+            std::lock_guard<std::mutex> lock(waypointNetworkMutex);
+            if (waypointNetwork.load()) {
+                waypointNetwork.store(std::make_shared<WaypointNetwork>());
+            }
         }
-        procedures.clear();
+        dataVersion++;
+        std::lock_guard<std::mutex> lock(_mutex);
+        airportProcedures.clear();
         procedureNameIndex.clear();
-        procedureAirportIndex.clear();
+        airportLoadOrder.clear();
+        airportLoadPositions.clear();
+        proceduresVersion++;
     }
 
-    static const std::vector<Procedure>& GetProcedures()
+    // All procedures, airport by airport in the order they were first loaded
+    static std::vector<ProcedurePtr> GetProcedures()
     {
-        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<std::shared_ptr<const AirportProcedures>> chunks;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            chunks.reserve(airportLoadOrder.size());
+            for (const auto& [position, icao] : airportLoadOrder) {
+                chunks.push_back(airportProcedures.at(icao));
+            }
+        }
+
+        std::vector<ProcedurePtr> procedures;
+        for (const auto& chunk : chunks) {
+            procedures.insert(
+                procedures.end(), chunk->procedures.begin(), chunk->procedures.end());
+        }
         return procedures;
     }
 
@@ -126,6 +343,13 @@ public:
      */
     static std::optional<Waypoint> FindWaypoint(std::string identifier);
 
+    /**
+     * @brief Finds every waypoint matching an identifier.
+     * @param identifier The identifier of the waypoint.
+     * @return All matching waypoints, empty if none.
+     */
+    static std::vector<Waypoint> FindWaypointCandidates(const std::string& identifier);
+
     /**
      * @brief Finds the closest waypoint to a given point by distance.
      * @param identifier The identifier of the waypoint.
@@ -136,9 +360,11 @@ public:
     static std::optional<Waypoint> FindClosestWaypoint(
         std::string identifier, erkir::spherical::Point referencePoint);
 
-    static std::shared_ptr<AirwayNetwork> GetAirwayNetwork() { return airwayNetwork; }
+    static std::shared_ptr<AirwayNetwork> GetAirwayNetwork() { return airwayNetwork.load(); }
+
+    static std::shared_ptr<AirportNetwork> GetAirportNetwork() { return airportNetwork.load(); }
 
-    static std::shared_ptr<RunwayNetwork> GetRunwayNetwork() { return runwayNetwork; }
+    static std::shared_ptr<RunwayNetwork> GetRunwayNetwork() { return runwayNetwork.load(); }
 
     static Waypoint FindOrCreateWaypointByID(
         std::string_view identifier, erkir::spherical::Point position)
@@ -156,19 +382,52 @@ public:
     }
 
 private:
+    // Caller holds _mutex. Names also in replacement are left in place.
+    static void RemoveFromNameIndex(const std::string& icao, const AirportProcedures& chunk,
+        const AirportProcedures* replacement = nullptr)
+    {
+        for (const auto& [name, _] : chunk.byName) {
+            if (replacement && replacement->byName.contains(name)) {
+                continue;
+            }
+            auto it = procedureNameIndex.find(name);
+            if (it == procedureNameIndex.end()) {
+                continue;
+            }
+            std::erase(it->second, icao);
+            if (it->second.empty()) {
+                procedureNameIndex.erase(it);
+            }
+        }
+    }
+
     inline static std::mutex _mutex;
     inline static std::mutex waypointsMutex;
 
     inline static std::unordered_map<std::string, Waypoint> waypoints = {};
-    inline static std::vector<Procedure> procedures = {};
-    inline static std::unordered_map<std::string, std::vector<size_t>> procedureNameIndex
-        = {};
-    inline static std::unordered_map<std::string, std::vector<size_t>>
-        procedureAirportIndex = {};
-    inline static std::shared_ptr<AirwayNetwork> airwayNetwork;
-    inline static std::shared_ptr<WaypointNetwork> waypointNetwork;
-    inline static std::shared_ptr<AirportNetwork> airportNetwork;
-    inline static std::shared_ptr<RunwayNetwork> runwayNetwork;
+    inline static std::unordered_map<std::string,
+        std::shared_ptr<const AirportProcedures>>
+        airportProcedures = {};
+    // Procedure name to the airports having a procedure of that name
+    inline static std::unordered_map<std::string, std::vector<std::string>>
+        procedureNameIndex = {};
+    // Airports in the order they were first loaded, by load position
+    inline static std::map<uint64_t, std::string> airportLoadOrder = {};
+    inline static std::unordered_map<std::string, uint64_t> airportLoadPositions = {};
+    inline static uint64_t nextLoadPosition = 0;
+    inline static std::atomic<uint64_t> proceduresVersion = 0;
+    // Waypoints, airways, airports and runways
+    inline static std::atomic<uint64_t> dataVersion = 0;
+    // Network to add providers to, created on first use
+    static std::shared_ptr<WaypointNetwork> EnsureWaypointNetwork();
+
+    // Snapshots, networks may be loaded in the background while routes are parsed
+    inline static SharedSnapshot<AirwayNetwork> airwayNetwork;
+    inline static SharedSnapshot<WaypointNetwork> waypointNetwork;
+    inline static SharedSnapshot<AirportNetwork> airportNetwork;
+    inline static SharedSnapshot<RunwayNetwork> runwayNetwork;
+    // Serialises creating and resetting the waypoint network
+    inline static std::mutex waypointNetworkMutex;
 };
 
 // const static auto NavdataContainer = std::make_shared<NavdataObject>();
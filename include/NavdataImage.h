@@ -0,0 +1,375 @@
+#pragma once
+#include "Log.h"
+#include "TemporaryPath.h"
+#include "Utils.h"
+#include "WaypointNetwork.h"
+#include "types/Waypoint.h"
+#include <SQLiteCpp/SQLiteCpp.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <limits>
+#include <mio/mmap.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @brief Read-only image of a waypoint source, mapped by every process of a host so
+ * the OS keeps a single copy of it.
+ *
+ * The layout has no pointers, only offsets from the start of the file: a header, the
+ * identifiers sorted bytewise, each with the range of its waypoints, the waypoint
+ * records and the string bytes. Integers and doubles are in the byte order of the
+ * host that built the image, images are not meant to move between architectures.
+ */
+namespace NavdataImage {
+    inline constexpr char Magic[8] = "RPNAV01";
+
+    struct Header {
+        char magic[8];
+        uint32_t identifierCount;
+        uint32_t waypointCount;
+        uint64_t identifiersOffset;
+        uint64_t waypointsOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    struct IdentifierEntry {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstWaypoint;
+        uint32_t waypointCount;
+    };
+
+    struct WaypointRecord {
+        double latitude;
+        double longitude;
+        int32_t frequencyHz;
+        uint32_t type;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+    };
+
+    /**
+     * @brief Writes an image of the waypoints, atomically replacing the file so that
+     * processes mapping it meanwhile never see it half written.
+     */
+    inline bool Build(const std::vector<Waypoint>& waypoints, const std::string& imagePath)
+    {
+        std::vector<const Waypoint*> sorted;
+        sorted.reserve(waypoints.size());
+        for (const auto& waypoint : waypoints) {
+            sorted.push_back(&waypoint);
+        }
+        // Stable, waypoints of an identifier keep the order of the source
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Waypoint* a, const Waypoint* b) {
+            return a->getIdentifier() < b->getIdentifier();
+        });
+
+        std::string strings;
+        std::vector<IdentifierEntry> identifiers;
+        std::vector<WaypointRecord> records;
+        records.reserve(sorted.size());
+        auto addString = [&strings](const std::string& value) {
+            const auto offset = static_cast<uint32_t>(strings.size());
+            strings.append(value);
+            return offset;
+        };
+        for (const auto* waypoint : sorted) {
+            const auto& identifier = waypoint->getIdentifier();
+            if (identifiers.empty()
+                || std::string_view(strings).substr(identifiers.back().nameOffset,
+                       identifiers.back().nameLength)
+                    != identifier) {
+                identifiers.push_back({ addString(identifier),
+                    static_cast<uint32_t>(identifier.size()),
+                    static_cast<uint32_t>(records.size()), 0 });
+            }
+            identifiers.back().waypointCount++;
+
+            // Names are mostly the identifier itself, stored once
+            const auto& name = waypoint->getName();
+            const auto nameOffset
+                = name == identifier ? identifiers.back().nameOffset : addString(name);
+            records.push_back({ waypoint->getPosition().latitude().degrees(),
+                waypoint->getPosition().longitude().degrees(), waypoint->getFrequencyHz(),
+                static_cast<uint32_t>(waypoint->getType()), nameOffset,
+                static_cast<uint32_t>(name.size()) });
+        }
+        if (strings.size() > std::numeric_limits<uint32_t>::max()) {
+            Log::error("Navdata image {} would be too large", imagePath);
+            return false;
+        }
+
+        Header header {};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.identifierCount = static_cast<uint32_t>(identifiers.size());
+        header.waypointCount = static_cast<uint32_t>(records.size());
+        header.identifiersOffset = sizeof(Header);
+        header.waypointsOffset
+            = header.identifiersOffset + identifiers.size() * sizeof(IdentifierEntry);
+        header.stringsOffset = header.waypointsOffset + records.size() * sizeof(WaypointRecord);
+        header.stringsSize = strings.size();
+
+        // Unique, several processes may build the same image at once
+        const auto temporaryPath = TemporaryPathFor(imagePath);
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(identifiers.data()),
+                identifiers.size() * sizeof(IdentifierEntry));
+            file.write(reinterpret_cast<const char*>(records.data()),
+                records.size() * sizeof(WaypointRecord));
+            // Never empty, an empty file cannot be mapped
+            file.write(strings.data(), strings.size());
+            file.put('\0');
+            if (!file) {
+                Log::error("Failed to write navdata image {}", temporaryPath);
+                file.close();
+                std::error_code ignored;
+                std::filesystem::remove(temporaryPath, ignored);
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, imagePath, error);
+        if (error) {
+            Log::error("Failed to replace navdata image {}: {}", imagePath, error.message());
+            std::error_code ignored;
+            std::filesystem::remove(temporaryPath, ignored);
+            return false;
+        }
+        Log::info("Built navdata image {} with {} waypoints", imagePath, records.size());
+        return true;
+    }
+
+    // Reads every row of a waypoint database, the same way its provider does
+    inline std::vector<Waypoint> ReadWaypoints(const std::string& dbPath, bool airwaysDb)
+    {
+        std::vector<Waypoint> waypoints;
+        try {
+            SQLite::Database db(dbPath, SQLite::OPEN_READONLY);
+            if (airwaysDb) {
+                SQLite::Statement query(db, "SELECT identifier, latitude, longitude FROM waypoints");
+                while (query.executeStep()) {
+                    std::string id = query.getColumn(0).getText();
+                    double lat = query.getColumn(1).isNull() ? 0.0 : query.getColumn(1).getDouble();
+                    double lon = query.getColumn(2).isNull() ? 0.0 : query.getColumn(2).getDouble();
+                    waypoints.emplace_back(Utils::GetWaypointTypeByIdentifier(id), id, id,
+                        erkir::spherical::Point(lat, lon));
+                }
+            } else {
+                SQLite::Statement query(db,
+                    "SELECT ident, type, frequency_khz, latitude_deg, longitude_deg FROM navaids");
+                while (query.executeStep()) {
+                    std::string id = query.getColumn(0).getText();
+                    int frequency = query.getColumn(2).isNull() ? 0 : query.getColumn(2).getInt();
+                    double lat = query.getColumn(3).isNull() ? 0.0 : query.getColumn(3).getDouble();
+                    double lon = query.getColumn(4).isNull() ? 0.0 : query.getColumn(4).getDouble();
+                    waypoints.emplace_back(Utils::GetWaypointTypeByTypeString(id), id, id,
+                        erkir::spherical::Point(lat, lon), frequency * 1000);
+                }
+            }
+        } catch (const SQLite::Exception& e) {
+            Log::error("Error reading waypoints from {}: {}", dbPath, e.what());
+        }
+        return waypoints;
+    }
+
+    inline bool BuildFromDatabase(
+        const std::string& dbPath, const std::string& imagePath, bool airwaysDb)
+    {
+        auto waypoints = ReadWaypoints(dbPath, airwaysDb);
+        if (waypoints.empty()) {
+            Log::error("No waypoints read from {}, navdata image not built", dbPath);
+            return false;
+        }
+        return Build(waypoints, imagePath);
+    }
+} // namespace NavdataImage
+
+/**
+ * @class MappedWaypointProvider
+ * @brief Waypoint provider reading a navdata image in place.
+ *
+ * Lookups are a binary search over the mapped identifiers, the only per process
+ * state is the mapping itself.
+ */
+class MappedWaypointProvider : public WaypointProvider {
+public:
+    MappedWaypointProvider(const std::string& path, const std::string& providerName,
+        int providerPriority = static_cast<int>(ProviderPriority::NAVDATA))
+        : imagePath(path)
+        , name(providerName)
+        , priority(providerPriority)
+    {
+    }
+
+    std::vector<Waypoint> findWaypoint(const std::string& identifier) override
+    {
+        std::vector<Waypoint> results;
+        if (!isInitialized()) {
+            Log::error("[{}] Attempted to find waypoint with unmapped image", name);
+            return results;
+        }
+        if (identifier.empty()) {
+            Log::error("[{}] Empty waypoint identifier provided", name);
+            return results;
+        }
+
+        const auto* entry = FindEntry(identifier);
+        if (!entry) {
+            return results;
+        }
+        results.reserve(entry->waypointCount);
+        const auto* records = Records() + entry->firstWaypoint;
+        for (uint32_t i = 0; i < entry->waypointCount; i++) {
+            const auto& record = records[i];
+            results.emplace_back(static_cast<WaypointType>(record.type), identifier,
+                std::string(String(record.nameOffset, record.nameLength)),
+                erkir::spherical::Point(record.latitude, record.longitude),
+                record.frequencyHz);
+        }
+        return results;
+    }
+
+    std::optional<Waypoint> findClosestWaypoint(
+        const std::string& identifier, const erkir::spherical::Point& reference) override
+    {
+        auto waypoints = findWaypoint(identifier);
+        std::optional<Waypoint> closest;
+        double minDistance = std::numeric_limits<double>::max();
+        for (const auto& waypoint : waypoints) {
+            const double distance = reference.distanceTo(waypoint.getPosition());
+            if (distance < minDistance) {
+                minDistance = distance;
+                closest = waypoint;
+            }
+        }
+        return closest;
+    }
+
+    bool initialize() override
+    {
+        using namespace NavdataImage;
+        std::error_code error;
+        mapping = mio::make_mmap_source(imagePath, 0, mio::map_entire_file, error);
+        if (error) {
+            Log::error("[{}] Failed to map navdata image {}: {}", name, imagePath,
+                error.message());
+            return false;
+        }
+
+        // Offsets are checked once, lookups then trust them
+        const uint64_t size = mapping.size();
+        const auto* header = GetHeader();
+        if (size < sizeof(Header) || std::memcmp(header->magic, Magic, sizeof(Magic)) != 0
+            || !FitsIn(size, header->identifiersOffset, header->identifierCount,
+                sizeof(IdentifierEntry), TableAlignment)
+            || !FitsIn(size, header->waypointsOffset, header->waypointCount,
+                sizeof(WaypointRecord), TableAlignment)
+            || !FitsIn(size, header->stringsOffset, header->stringsSize, 1, 1)) {
+            Log::error("[{}] Invalid navdata image {}", name, imagePath);
+            mapping.unmap();
+            return false;
+        }
+        for (uint32_t i = 0; i < header->identifierCount; i++) {
+            const auto& entry = Entries()[i];
+            if (uint64_t { entry.nameOffset } + entry.nameLength > header->stringsSize
+                || uint64_t { entry.firstWaypoint } + entry.waypointCount
+                    > header->waypointCount) {
+                Log::error("[{}] Corrupt identifier in navdata image {}", name, imagePath);
+                mapping.unmap();
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < header->waypointCount; i++) {
+            const auto& record = Records()[i];
+            if (uint64_t { record.nameOffset } + record.nameLength > header->stringsSize) {
+                Log::error("[{}] Corrupt waypoint in navdata image {}", name, imagePath);
+                mapping.unmap();
+                return false;
+            }
+        }
+
+        Log::info("[{}] Mapped navdata image with {} waypoints (Priority: {})", name,
+            header->waypointCount, priority);
+        return true;
+    }
+
+    bool isInitialized() const override { return mapping.is_open(); }
+
+    std::string getName() const override { return name; }
+
+    int getPriority() const override { return priority; }
+
+    // Mapped pages are shared with every process mapping the image
+    MemoryUsageEntry memoryUsage() const override
+    {
+        return { name, isInitialized() ? GetHeader()->waypointCount : 0, mapping.size() };
+    }
+
+private:
+    // Records are read in place, their tables must be aligned for the doubles
+    static constexpr uint64_t TableAlignment = 8;
+
+    // Whether count records at offset lie within size bytes, without overflowing
+    static bool FitsIn(
+        uint64_t size, uint64_t offset, uint64_t count, uint64_t recordSize, uint64_t alignment)
+    {
+        return offset % alignment == 0 && offset <= size
+            && count <= (size - offset) / recordSize;
+    }
+
+    const NavdataImage::Header* GetHeader() const
+    {
+        return reinterpret_cast<const NavdataImage::Header*>(mapping.data());
+    }
+
+    const NavdataImage::IdentifierEntry* Entries() const
+    {
+        return reinterpret_cast<const NavdataImage::IdentifierEntry*>(
+            mapping.data() + GetHeader()->identifiersOffset);
+    }
+
+    const NavdataImage::WaypointRecord* Records() const
+    {
+        return reinterpret_cast<const NavdataImage::WaypointRecord*>(
+            mapping.data() + GetHeader()->waypointsOffset);
+    }
+
+    std::string_view String(uint32_t offset, uint32_t length) const
+    {
+        return { mapping.data() + GetHeader()->stringsOffset + offset, length };
+    }
+
+    const NavdataImage::IdentifierEntry* FindEntry(std::string_view identifier) const
+    {
+        const auto* begin = Entries();
+        const auto* end = begin + GetHeader()->identifierCount;
+        const auto* it = std::lower_bound(begin, end, identifier,
+            [this](const NavdataImage::IdentifierEntry& entry, std::string_view value) {
+                return String(entry.nameOffset, entry.nameLength) < value;
+            });
+        if (it == end || String(it->nameOffset, it->nameLength) != identifier) {
+            return nullptr;
+        }
+        return it;
+    }
+
+    std::string imagePath;
+    std::string name;
+    int priority;
+    mio::mmap_source mapping;
+};
+
+} // namespace RouteParser
@@ -0,0 +1,48 @@
+#pragma once
+#include "types/Waypoint.h"
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @class ParseArena
+ * @brief Monotonic memory for the temporaries of a single parse.
+ *
+ * The scratch containers of a parse all die with it, so their memory is handed out
+ * from an inline buffer and released at once when the parse returns instead of going
+ * back and forth through the shared heap. Longer routes spill over to the upstream
+ * resource.
+ */
+class ParseArena {
+public:
+    // Covers the scratch data of typical routes without touching the heap
+    static constexpr size_t InlineBytes = 16 * 1024;
+
+    explicit ParseArena(
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : resource(buffer.data(), buffer.size(), upstream)
+    {
+    }
+
+    ParseArena(const ParseArena&) = delete;
+    ParseArena& operator=(const ParseArena&) = delete;
+
+    std::pmr::memory_resource* get() { return &resource; }
+
+private:
+    alignas(std::max_align_t) std::array<std::byte, InlineBytes> buffer;
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+// Scratch containers of a parse, allocated from its arena
+using RouteTokens = std::pmr::vector<std::pmr::string>;
+using ResolvedWaypoints = std::pmr::vector<std::optional<Waypoint>>;
+// Waypoints matching each token, empty where the token was not looked up
+using WaypointCandidates = std::pmr::vector<std::optional<std::vector<Waypoint>>>;
+
+} // namespace RouteParser
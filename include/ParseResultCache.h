@@ -0,0 +1,145 @@
+#pragma once
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "types/MemoryUsage.h"
+#include "WaypointResolver.h"
+#include "types/ParsedRoute.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace RouteParser {
+
+// Everything a parse result depends on
+struct ParseCacheKey {
+    std::string route; // Cleaned route
+    std::string origin;
+    std::string destination;
+    FlightRule flightRule;
+    ParseOptions options;
+    WaypointResolutionMode resolution;
+    uint64_t navdataVersion;
+    uint64_t runwayVersion;
+
+    bool operator==(const ParseCacheKey&) const = default;
+
+    template <typename H> friend H AbslHashValue(H h, const ParseCacheKey& key)
+    {
+        return H::combine(std::move(h), key.route, key.origin, key.destination,
+            static_cast<int>(key.flightRule), key.options.suggestions,
+            key.options.explicitRoute, key.options.errorMessages, key.options.headings,
+            key.options.plannedAltitudeAndSpeed, static_cast<int>(key.resolution),
+            key.navdataVersion, key.runwayVersion);
+    }
+};
+
+struct ParseCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t size = 0;
+
+    double HitRate() const
+    {
+        const auto total = hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(hits) / total;
+    }
+};
+
+/**
+ * @class ParseResultCache
+ * @brief Bounded LRU cache of parse results.
+ *
+ * Results are immutable and shared between callers. Entries of older navdata or
+ * runway versions are never hit again and age out of the LRU.
+ */
+class ParseResultCache {
+public:
+    explicit ParseResultCache(size_t capacity)
+        : capacity(capacity)
+    {
+    }
+
+    std::shared_ptr<const ParsedRoute> Find(const ParseCacheKey& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(key);
+        if (it == index.end()) {
+            misses++;
+            return nullptr;
+        }
+
+        // Move to the front, most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        hits++;
+        return it->second->second;
+    }
+
+    void Insert(const ParseCacheKey& key, std::shared_ptr<const ParsedRoute> result)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (capacity == 0) {
+            return;
+        }
+
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = std::move(result);
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        entries.emplace_front(key, std::move(result));
+        index.emplace(key, entries.begin());
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        index.clear();
+    }
+
+    ParseCacheStats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return { hits, misses, entries.size() };
+    }
+
+    // The cached results, their keys and the LRU bookkeeping
+    MemoryUsageEntry GetMemoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t bytes = index.capacity() * (sizeof(ParseCacheKey) + sizeof(void*) + 1);
+        for (const auto& [key, result] : entries) {
+            const auto keyBytes = MemoryEstimate::HeapBytes(key.route)
+                + MemoryEstimate::HeapBytes(key.origin)
+                + MemoryEstimate::HeapBytes(key.destination);
+            // List node, the key copy in the index and the shared result
+            bytes += sizeof(Entry) + 2 * sizeof(void*) + 2 * keyBytes;
+            if (result) {
+                bytes += sizeof(ParsedRoute) + 2 * sizeof(void*)
+                    + MemoryEstimate::HeapBytes(*result);
+            }
+        }
+        return { "parse result cache", entries.size(), bytes };
+    }
+
+private:
+    using Entry = std::pair<ParseCacheKey, std::shared_ptr<const ParsedRoute>>;
+
+    const size_t capacity;
+    mutable std::mutex mutex;
+    std::list<Entry> entries; // Most recently used first
+    absl::flat_hash_map<ParseCacheKey, std::list<Entry>::iterator> index;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+} // namespace RouteParser
@@ -7,10 +7,53 @@
 #include <memory>
 #include "Navdata.h"
 #include "AirportConfigurator.h"
+#include "Executor.h"
+#include "ParseArena.h"
+#include "ParseResultCache.h"
+#include "SharedSnapshot.h"
+#include "Task.h"
+#include "ThreadPool.h"
+#include "WaypointResolver.h"
+#include <atomic>
 #include <regex>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace RouteParser
 {
+    // An airway traversal of a previous parse, valid while the navdata is unchanged
+    struct AirwayExpansion {
+        Waypoint entry;
+        std::string airway;
+        std::string exit;
+        std::vector<ParsedRouteSegment> segments;
+        // Entered right where another airway ended
+        bool chained = false;
+    };
+
+    // Waypoint lookups of a parse made ahead of the main pass, by token index
+    struct RouteResolution {
+        // Route-level pick, empty where the candidate closest to the previous
+        // waypoint is taken
+        ResolvedWaypoints picks;
+        WaypointCandidates candidates;
+
+        // The waypoint of a token reached from previousWaypoint
+        std::optional<Waypoint> Pick(size_t index, std::string_view identifier,
+            const std::optional<Waypoint>& previousWaypoint) const;
+    };
+
+    // What a reparse takes over from the previous parse of an amended route
+    struct ReparseSeed {
+        std::vector<AirwayExpansion> airways;
+        // Greedy picks by token index, reused up to the first amended token
+        std::vector<std::string> tokens;
+        std::vector<std::optional<Waypoint>> picks;
+        std::string origin;
+        std::string destination;
+    };
+
     /**
      * @class Parser
      * @brief A class to parse and handle routes.
@@ -26,6 +69,12 @@ namespace RouteParser
     private:
         std::shared_ptr<NavdataObject> navdata;
         std::shared_ptr<AirportConfigurator> airportConfigurator;
+        std::atomic<WaypointResolutionMode> waypointResolution = RESOLVE_ROUTE;
+        // Disabled unless EnableResultCache is called. Parses read it without locking
+        // while it may be replaced.
+        SharedSnapshot<ParseResultCache> resultCache;
+        // Disabled unless EnablePrefetch is called
+        SharedSnapshot<ThreadPool> prefetchPool;
         /**
          * @brief Parses the first and last part of the route.
          * @param parsedRoute The parsed route object.
@@ -37,7 +86,7 @@ namespace RouteParser
          * if the found procedure is not in dataset
          */
         bool ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
-            std::string token, std::string anchorIcao, bool strict,
+            std::string_view token, const std::string& anchorIcao, bool strict,
             std::string& tokenToRemove,
             FlightRule currentFlightRule = IFR);
         /**
@@ -46,56 +95,90 @@ namespace RouteParser
          * @param index The index of the current token.
          * @param token The current token being processed.
          * @param previousWaypoint The previous waypoint, if any.
+         * @param resolution The lookups made ahead of the main pass, if any, otherwise
+         * the waypoint closest to the previous one is looked up.
          */
-        bool ParseWaypoints(ParsedRoute& parsedRoute, int index, std::string token,
+        bool ParseWaypoints(ParsedRoute& parsedRoute, int index, std::string_view routeToken,
             std::optional<Waypoint>& previousWaypoint,
-            FlightRule currentFlightRule);
+            FlightRule currentFlightRule,
+            const RouteResolution* resolution = nullptr);
+        /**
+         * @brief Looks the candidates of every identifier token up and picks them all
+         * at once, see WaypointResolver.
+         * @param routeParts The route tokens.
+         * @param airwayTokens Whether each token is a known airway.
+         * @param origin The origin airport, if known.
+         * @param destination The destination airport, if known.
+         * @param arena The memory of the parse, the result is allocated from it.
+         * @return The candidates and picked waypoint by token index, no candidates are
+         * looked up under RESOLVE_GREEDY.
+         */
+        RouteResolution ResolveRouteWaypoints(WaypointResolutionMode mode,
+            std::span<const std::pmr::string> routeParts,
+            const std::pmr::vector<bool>& airwayTokens,
+            const std::optional<Waypoint>& origin,
+            const std::optional<Waypoint>& destination, ParseArena& arena);
+        /**
+         * @brief Collects the airway traversals and greedy picks of a previous parse
+         * that an amended route can reuse.
+         * @param previous The previous parse result.
+         */
+        static ReparseSeed BuildReparseSeed(const ParsedRoute& previous);
+        // The parse behind every public entry point, with the resolution mode read once
+        ParsedRoute ParseRawRouteSeeded(std::string route, std::string origin,
+            std::string destination, FlightRule filedFlightRule,
+            const ParseOptions& options, WaypointResolutionMode resolution,
+            const ReparseSeed* seed);
+        ParseCacheKey MakeCacheKey(const std::string& route, const std::string& origin,
+            const std::string& destination, FlightRule filedFlightRule,
+            const ParseOptions& options) const;
+        // Cached result for the route, nullptr on a miss
+        std::shared_ptr<const ParsedRoute> FindCachedResult(ParseResultCache& cache,
+            const ParseCacheKey& key, const std::string& route) const;
+        /**
+         * @brief Queues lookups of the identifier-shaped tokens on the prefetch pool.
+         * @return Flag to set once the parse is over, pending lookups are then
+         * dropped. nullptr when prefetching is disabled.
+         */
+        std::shared_ptr<std::atomic<bool>> PrefetchLookups(
+            std::span<const std::pmr::string> routeParts, const std::string& origin,
+            const std::string& destination);
         // 57N020W 59S030E 60N040W for no minutes, or 5220N03305E for minutes
-        bool ParseLatLon(ParsedRoute& parsedRoute, int index, std::string token,
+        bool ParseLatLon(ParsedRoute& parsedRoute, int index, std::string_view routeToken,
             std::optional<Waypoint>& previousWaypoint,
             FlightRule currentFlightRule);
         std::optional<RouteWaypoint::PlannedAltitudeAndSpeed>
-            ParsePlannedAltitudeAndSpeed(int index, std::string rightToken);
+            ParsePlannedAltitudeAndSpeed(int index, std::string_view rightToken);
         bool ParseFlightRule(FlightRule& currentFlightRule, int index,
-            std::string token);
-
-        /**
-         * @brief Generates a complete set of explicit segments for the entire route including SIDs and STARs
-         * @param parsedRoute The parsed route to generate explicit segments for
-         * @param origin The origin airport ICAO
-         * @param destination The destination airport ICAO
-         */
-        void GenerateExplicitSegments(ParsedRoute& parsedRoute,
-            const std::string& origin,
-            const std::string& destination);
+            std::string_view token);
 
-        void AddAppropriateError(ParsedRoute& parsedRoute, int tokenIndex, const std::string& token, const std::string& tokenType) {
+        void AddAppropriateError(ParsedRoute& parsedRoute, int tokenIndex, std::string_view token, std::string_view tokenType) {
             ParsingErrorType errorCode;
-            std::string errorMessage;
+            ParsingErrorMessage errorMessage;
 
             if (tokenType == "AIRWAY") {
                 errorCode = UNKNOWN_AIRWAY;
-                errorMessage = "Unknown airway";
+                errorMessage = MESSAGE_UNKNOWN_AIRWAY;
             }
             else if (tokenType == "AIRPORT") {
                 errorCode = UNKNOWN_AIRPORT;
-                errorMessage = "Unknown airport code";
+                errorMessage = MESSAGE_UNKNOWN_AIRPORT;
             }
             else if (tokenType == "NAVAID") {
                 errorCode = UNKNOWN_NAVAID;
-                errorMessage = "Unknown navigational aid";
+                errorMessage = MESSAGE_UNKNOWN_NAVAID;
             }
             else if (tokenType == "FIX") {
                 errorCode = UNKNOWN_WAYPOINT;
-                errorMessage = "Unknown waypoint";
+                errorMessage = MESSAGE_UNKNOWN_WAYPOINT;
             }
             else {
                 errorCode = INVALID_TOKEN_FORMAT;
-                errorMessage = "Unrecognized token format";
+                errorMessage = MESSAGE_UNRECOGNIZED_TOKEN;
             }
 
-            parsedRoute.errors.push_back(
-                ParsingError{ errorCode, errorMessage, tokenIndex, token, PARSE_ERROR });
+            parsedRoute.errors.push_back(ParsingError{
+                errorCode, errorMessage, {}, tokenIndex, std::string(token), PARSE_ERROR });
         }
 
 
@@ -110,16 +193,101 @@ namespace RouteParser
 
         static const std::regex sidStarPattern;
         static const std::regex altitudeSpeedPattern;
+        static const std::regex procedureOrAirportPattern;
+        static const std::regex procedureNamePattern;
+        static const std::regex starCandidatePattern;
+        static const std::regex runwayPattern;
+
+        void SetWaypointResolution(WaypointResolutionMode mode)
+        {
+            waypointResolution = mode;
+            // Results of the other mode are keyed apart, this only frees them
+            if (const auto cache = resultCache.load()) {
+                cache->Clear();
+            }
+        }
+
+        /**
+         * @brief Enables the result cache used by ParseRawRouteShared.
+         * @param capacity The maximum number of cached routes, 0 disables the cache.
+         */
+        void EnableResultCache(size_t capacity)
+        {
+            resultCache
+                = capacity > 0 ? std::make_shared<ParseResultCache>(capacity) : nullptr;
+        }
+
+        /**
+         * @brief Looks the waypoints and airways of each route up on a background
+         * pool as soon as it is tokenised, so the parse mostly hits the lookup caches.
+         * Only pays off when lookups wait on the disk, as on a cold page cache.
+         * @param threads The number of prefetch threads, 0 disables prefetching.
+         */
+        void EnablePrefetch(size_t threads)
+        {
+            prefetchPool = threads > 0 ? std::make_shared<ThreadPool>(threads) : nullptr;
+        }
+
+        ParseCacheStats GetResultCacheStats() const
+        {
+            const auto cache = resultCache.load();
+            return cache ? cache->GetStats() : ParseCacheStats {};
+        }
+
+        MemoryUsageEntry GetResultCacheMemoryUsage() const
+        {
+            const auto cache = resultCache.load();
+            return cache ? cache->GetMemoryUsage() : MemoryUsageEntry { "parse result cache" };
+        }
 
         void CleanupUnrecognizedPatterns(ParsedRoute& parsedRoute, const std::string& origin, const std::string& destination);
 
-        bool ParseAirway(ParsedRoute& parsedRoute, int index, std::string token,
+        // exitWaypoint is the waypoint of nextToken, looked up when empty
+        bool ParseAirway(ParsedRoute& parsedRoute, int index, std::string_view token,
             std::optional<Waypoint>& previousWaypoint,
-            std::optional<std::string> nextToken,
-            FlightRule currentFlightRule);
+            std::string_view nextToken,
+            FlightRule currentFlightRule,
+            const std::vector<AirwayExpansion>* knownAirways = nullptr,
+            const std::optional<Waypoint>& exitWaypoint = std::nullopt);
+        /**
+         * @brief Parses a raw route string.
+         * @param options The stages to run, see ParseOptions for the presets.
+         */
         ParsedRoute ParseRawRoute(std::string route, std::string origin,
             std::string destination,
-            FlightRule filedFlightRule = IFR);
+            FlightRule filedFlightRule = IFR,
+            const ParseOptions& options = ParseOptions::Full());
+        /**
+         * @brief Same as ParseRawRoute, served from the result cache when enabled.
+         * @return The shared, immutable parse result.
+         */
+        std::shared_ptr<const ParsedRoute> ParseRawRouteShared(const std::string& route,
+            const std::string& origin, const std::string& destination,
+            FlightRule filedFlightRule = IFR,
+            const ParseOptions& options = ParseOptions::Full());
+        /**
+         * @brief Same as ParseRawRouteShared, without blocking the calling thread on
+         * navdata lookups. A result cache hit completes on the calling thread, any
+         * other parse suspends onto the executor and completes there.
+         * @param executor Runs the parse, must outlive the task, as must the parser.
+         */
+        Task<ParsedRoute> ParseRawRouteAsync(Executor& executor, std::string route,
+            std::string origin, std::string destination,
+            FlightRule filedFlightRule = IFR,
+            ParseOptions options = ParseOptions::Full());
+        /**
+         * @brief Parses an amended route, reusing the airway traversals of the
+         * previous parse that have the same entry waypoint, airway and exit. The
+         * result is the same as ParseRawRoute: a route-level pick may change with any
+         * token, so waypoints are all resolved again, mostly from the lookup cache.
+         * @param previous The previous result for the same origin, destination and
+         * flight rule.
+         * @param route The amended raw route string.
+         */
+        ParsedRoute ReparseRawRoute(const ParsedRoute& previous, std::string route,
+            std::string origin, std::string destination,
+            FlightRule filedFlightRule = IFR,
+            const ParseOptions& options = ParseOptions::Full());
         void AddDirectSegment(ParsedRoute& parsedRoute,
             const RouteWaypoint& fromWaypoint, const RouteWaypoint& toWaypoint);
         void AddConnectionSegments(ParsedRoute& parsedRoute,
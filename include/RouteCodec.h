@@ -0,0 +1,539 @@
+#pragma once
+#include "exceptions/CodecExceptions.h"
+#include "types/CompactParsedRoute.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @brief Binary wire format of parse results, for fanning them out to clients.
+ *
+ * Layout: the magic "RPB", a version byte, the string table, then the route. All
+ * integers are LEB128 varints, signed ones zigzag encoded. Every string, from
+ * identifiers to error arguments, is written once in the table and referred to by
+ * index. Waypoints are stored once, as in CompactParsedRoute, and segments refer to
+ * them by index. Coordinates are quantised to 1e-7 degrees, about a centimetre, and
+ * written as the difference to the previous coordinate of the stream. Error messages
+ * travel as their code and arguments and are rendered by the receiver.
+ */
+namespace RouteCodec {
+    inline constexpr std::string_view Magic = "RPB";
+    inline constexpr uint8_t Version = 1;
+    // Coordinate units per degree
+    inline constexpr double CoordinateScale = 1e7;
+
+    enum WaypointFlags : uint8_t {
+        WAYPOINT_VFR = 1 << 0,
+        WAYPOINT_PLANNED = 1 << 1,
+        // Name equal to the identifier, not written
+        WAYPOINT_NAME_IS_IDENTIFIER = 1 << 2,
+        WAYPOINT_PLANNED_ALTITUDE = 1 << 3,
+        WAYPOINT_PLANNED_SPEED = 1 << 4
+    };
+
+    inline uint64_t ZigZag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t UnZigZag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    class Encoder {
+    public:
+        void Unsigned(uint64_t value)
+        {
+            while (value >= 0x80) {
+                body.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            body.push_back(static_cast<char>(value));
+        }
+
+        void Signed(int64_t value) { Unsigned(ZigZag(value)); }
+
+        void String(const std::string& value) { Unsigned(Intern(value)); }
+
+        // 0 for none, index + 1 otherwise
+        void OptionalString(const std::optional<std::string>& value)
+        {
+            Unsigned(value ? Intern(*value) + uint64_t { 1 } : 0);
+        }
+
+        void OptionalInt(const std::optional<int>& value)
+        {
+            if (value) {
+                Signed(*value);
+            }
+        }
+
+        void Position(const erkir::spherical::Point& position)
+        {
+            const auto latitude = Quantise(position.latitude().degrees());
+            const auto longitude = Quantise(position.longitude().degrees());
+            Signed(latitude - previousLatitude);
+            Signed(longitude - previousLongitude);
+            previousLatitude = latitude;
+            previousLongitude = longitude;
+        }
+
+        void ProcedureWaypoint(const Waypoint& waypoint) { WaypointFields(waypoint, 0); }
+
+        void PoolWaypoint(const RouteWaypoint& waypoint)
+        {
+            const auto& planned = waypoint.m_plannedPosition;
+            uint8_t flags = waypoint.GetFlightRule() == VFR ? WAYPOINT_VFR : 0;
+            if (planned) {
+                flags |= WAYPOINT_PLANNED;
+                flags |= planned->plannedAltitude ? WAYPOINT_PLANNED_ALTITUDE : 0;
+                flags |= planned->plannedSpeed ? WAYPOINT_PLANNED_SPEED : 0;
+            }
+            WaypointFields(waypoint, flags);
+            if (planned) {
+                OptionalInt(planned->plannedAltitude);
+                OptionalInt(planned->plannedSpeed);
+                Unsigned(planned->altitudeUnit);
+                Unsigned(planned->speedUnit);
+            }
+        }
+
+        void Indices(const std::vector<uint32_t>& indices)
+        {
+            Unsigned(indices.size());
+            for (const auto index : indices) {
+                Unsigned(index);
+            }
+        }
+
+        void Segments(const std::vector<CompactSegment>& segments,
+            const std::vector<std::string>& airwayNames)
+        {
+            Unsigned(segments.size());
+            for (const auto& segment : segments) {
+                Unsigned(segment.from);
+                Unsigned(segment.to);
+                String(airwayNames[segment.airway]);
+                Signed(segment.heading);
+                Signed(segment.minimumLevel);
+            }
+        }
+
+        void Error(const ParsingError& error)
+        {
+            Unsigned(error.type);
+            Unsigned(error.level);
+            Unsigned(error.messageCode);
+            Signed(error.tokenIndex);
+            String(error.token);
+            Unsigned(error.arguments.size());
+            for (const auto& argument : error.arguments) {
+                // Lowest bit tells strings and integers apart
+                if (const auto* text = std::get_if<std::string>(&argument)) {
+                    Unsigned(uint64_t { Intern(*text) } << 1);
+                } else {
+                    Unsigned(ZigZag(std::get<int>(argument)) << 1 | 1);
+                }
+            }
+        }
+
+        void ProcedureOrNull(const ProcedurePtr& procedure)
+        {
+            if (!procedure) {
+                Unsigned(0);
+                return;
+            }
+            Unsigned(1);
+            String(procedure->name);
+            String(procedure->runway);
+            String(procedure->icao);
+            Unsigned(procedure->type);
+            Unsigned(procedure->waypoints.size());
+            for (const auto& waypoint : procedure->waypoints) {
+                ProcedureWaypoint(waypoint);
+            }
+        }
+
+        // Appends the header, the string table and the encoded body
+        void Finish(std::string& out)
+        {
+            // The table is only complete now, it is written in front of the body
+            std::string route;
+            std::swap(route, body);
+            Unsigned(strings.size());
+            for (const auto* string : strings) {
+                Unsigned(string->size());
+                body.append(*string);
+            }
+
+            out.append(Magic);
+            out.push_back(static_cast<char>(Version));
+            out.append(body);
+            out.append(route);
+        }
+
+    private:
+        void WaypointFields(const Waypoint& waypoint, uint8_t flags)
+        {
+            if (waypoint.getName() == waypoint.getIdentifier()) {
+                flags |= WAYPOINT_NAME_IS_IDENTIFIER;
+            }
+            body.push_back(static_cast<char>(flags));
+            Unsigned(waypoint.getType());
+            String(waypoint.getIdentifier());
+            if (!(flags & WAYPOINT_NAME_IS_IDENTIFIER)) {
+                String(waypoint.getName());
+            }
+            Signed(waypoint.getFrequencyHz());
+            Position(waypoint.getPosition());
+        }
+
+        uint32_t Intern(const std::string& value)
+        {
+            auto [it, inserted]
+                = stringIndices.try_emplace(value, static_cast<uint32_t>(strings.size()));
+            if (inserted) {
+                strings.push_back(&it->first);
+            }
+            return it->second;
+        }
+
+        static int64_t Quantise(double degrees)
+        {
+            return std::llround(degrees * CoordinateScale);
+        }
+
+        std::string body;
+        // Node map, the table points at its keys
+        absl::node_hash_map<std::string, uint32_t> stringIndices;
+        std::vector<const std::string*> strings;
+        int64_t previousLatitude = 0;
+        int64_t previousLongitude = 0;
+    };
+
+    class Decoder {
+    public:
+        explicit Decoder(std::string_view data)
+            : data(data)
+        {
+            if (data.substr(0, Magic.size()) != Magic) {
+                throw RouteDecodeException("Not an encoded route");
+            }
+            position = Magic.size();
+            if (Byte() != Version) {
+                throw RouteDecodeException("Unsupported encoded route version");
+            }
+            const auto count = Count();
+            strings.reserve(count);
+            for (size_t i = 0; i < count; i++) {
+                const auto length = Count();
+                strings.emplace_back(data.substr(position, length));
+                position += length;
+            }
+        }
+
+        uint8_t Byte()
+        {
+            Need(1);
+            return static_cast<uint8_t>(data[position++]);
+        }
+
+        uint64_t Unsigned()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                const auto byte = Byte();
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+            throw RouteDecodeException("Malformed varint");
+        }
+
+        int64_t Signed() { return UnZigZag(Unsigned()); }
+
+        int Int() { return static_cast<int>(Signed()); }
+
+        // Element count, never more than the bytes left
+        size_t Count()
+        {
+            const auto count = Unsigned();
+            Need(count);
+            return static_cast<size_t>(count);
+        }
+
+        const std::string& String() { return StringAt(Unsigned()); }
+
+        std::optional<std::string> OptionalString()
+        {
+            const auto index = Unsigned();
+            if (index == 0) {
+                return std::nullopt;
+            }
+            return StringAt(index - 1);
+        }
+
+        erkir::spherical::Point Position()
+        {
+            latitude = Coordinate(latitude, Signed(), 90);
+            longitude = Coordinate(longitude, Signed(), 180);
+            return erkir::spherical::Point(
+                latitude / CoordinateScale, longitude / CoordinateScale);
+        }
+
+        Waypoint ProcedureWaypoint() { return WaypointFields(Byte()); }
+
+        RouteWaypoint PoolWaypoint()
+        {
+            const auto flags = Byte();
+            RouteWaypoint waypoint(WaypointFields(flags), flags & WAYPOINT_VFR ? VFR : IFR);
+            if (flags & WAYPOINT_PLANNED) {
+                RouteWaypoint::PlannedAltitudeAndSpeed planned;
+                if (flags & WAYPOINT_PLANNED_ALTITUDE) {
+                    planned.plannedAltitude = Int();
+                }
+                if (flags & WAYPOINT_PLANNED_SPEED) {
+                    planned.plannedSpeed = Int();
+                }
+                planned.altitudeUnit = Enumerator(Units::Distance::METERS);
+                planned.speedUnit = Enumerator(Units::Speed::KMH);
+                waypoint.m_plannedPosition = planned;
+            }
+            return waypoint;
+        }
+
+        std::vector<uint32_t> Indices(size_t poolSize)
+        {
+            std::vector<uint32_t> indices(Count());
+            for (auto& index : indices) {
+                index = PoolIndex(poolSize);
+            }
+            return indices;
+        }
+
+        std::vector<CompactSegment> Segments(CompactParsedRoute& route)
+        {
+            const auto poolSize = route.waypointPool.size();
+            std::vector<CompactSegment> segments(Count());
+            for (auto& segment : segments) {
+                segment.from = PoolIndex(poolSize);
+                segment.to = PoolIndex(poolSize);
+                segment.airway = Airway(route, String());
+                segment.heading = Int();
+                segment.minimumLevel = Int();
+            }
+            return segments;
+        }
+
+        ParsingError Error()
+        {
+            ParsingError error;
+            error.type = Enumerator(MULTIPLE_AIRWAYS_FOUND);
+            error.level = Enumerator(PARSE_ERROR);
+            error.messageCode = Enumerator(MESSAGE_RUNWAY_NOT_FOUND);
+            error.tokenIndex = Int();
+            error.token = String();
+            error.arguments.resize(Count());
+            for (auto& argument : error.arguments) {
+                const auto value = Unsigned();
+                if (value & 1) {
+                    argument = static_cast<int>(UnZigZag(value >> 1));
+                } else {
+                    argument = StringAt(value >> 1);
+                }
+            }
+            // Rendered by the receiver, which would fail on it later
+            if (error.arguments.size() < GetMessageArgumentCount(error.messageCode)) {
+                throw RouteDecodeException("Missing error message arguments");
+            }
+            return error;
+        }
+
+        ProcedurePtr ProcedureOrNull()
+        {
+            if (Unsigned() == 0) {
+                return nullptr;
+            }
+            auto procedure = std::make_shared<Procedure>();
+            procedure->name = String();
+            procedure->runway = String();
+            procedure->icao = String();
+            procedure->type = Enumerator(PROCEDURE_STAR);
+            procedure->waypoints.resize(Count());
+            for (auto& waypoint : procedure->waypoints) {
+                waypoint = ProcedureWaypoint();
+            }
+            return procedure;
+        }
+
+        bool AtEnd() const { return position == data.size(); }
+
+    private:
+        void Need(uint64_t bytes) const
+        {
+            if (bytes > data.size() - position) {
+                throw RouteDecodeException("Truncated encoded route");
+            }
+        }
+
+        const std::string& StringAt(uint64_t index) const
+        {
+            if (index >= strings.size()) {
+                throw RouteDecodeException("String index out of range");
+            }
+            return strings[index];
+        }
+
+        // Value of an enum, last being its highest enumerator
+        template <typename Enum> Enum Enumerator(Enum last)
+        {
+            const auto value = Unsigned();
+            if (value > static_cast<uint64_t>(last)) {
+                throw RouteDecodeException("Enum value out of range");
+            }
+            return static_cast<Enum>(value);
+        }
+
+        // Previous coordinate moved by a delta, within the given degrees either way
+        static int64_t Coordinate(int64_t previous, int64_t delta, int degrees)
+        {
+            const auto limit = static_cast<int64_t>(degrees * CoordinateScale);
+            // previous is within the limit, so a delta within twice of it cannot overflow
+            if (delta < -2 * limit || delta > 2 * limit || previous + delta < -limit
+                || previous + delta > limit) {
+                throw RouteDecodeException("Coordinate out of range");
+            }
+            return previous + delta;
+        }
+
+        uint32_t PoolIndex(size_t poolSize)
+        {
+            const auto index = Unsigned();
+            if (index >= poolSize) {
+                throw RouteDecodeException("Waypoint index out of range");
+            }
+            return static_cast<uint32_t>(index);
+        }
+
+        uint32_t Airway(CompactParsedRoute& route, const std::string& name)
+        {
+            auto [it, inserted]
+                = airwayIndices.try_emplace(name, static_cast<uint32_t>(route.airwayNames.size()));
+            if (inserted) {
+                route.airwayNames.push_back(name);
+            }
+            return it->second;
+        }
+
+        Waypoint WaypointFields(uint8_t flags)
+        {
+            const auto type = Enumerator(UNKNOWN);
+            const auto identifier = String();
+            const auto& name = flags & WAYPOINT_NAME_IS_IDENTIFIER ? identifier : String();
+            const auto frequencyHz = Int();
+            return { type, identifier, name, Position(), frequencyHz };
+        }
+
+        std::string_view data;
+        size_t position = 0;
+        std::vector<std::string> strings;
+        absl::flat_hash_map<std::string, uint32_t> airwayIndices;
+        int64_t latitude = 0;
+        int64_t longitude = 0;
+    };
+} // namespace RouteCodec
+
+/**
+ * @brief Encodes a parse result, including its explicit route.
+ * @param out The buffer the encoded route is appended to.
+ */
+inline void EncodeCompactRoute(const CompactParsedRoute& route, std::string& out)
+{
+    RouteCodec::Encoder encoder;
+    encoder.String(route.rawRoute);
+    encoder.Signed(route.totalTokens);
+    encoder.Unsigned(route.waypointPool.size());
+    for (const auto& waypoint : route.waypointPool) {
+        encoder.PoolWaypoint(waypoint);
+    }
+    encoder.Indices(route.waypoints);
+    encoder.Segments(route.segments, route.airwayNames);
+    encoder.Indices(route.explicitWaypoints);
+    encoder.Segments(route.explicitSegments, route.airwayNames);
+    encoder.Unsigned(route.errors.size());
+    for (const auto& error : route.errors) {
+        encoder.Error(error);
+    }
+    encoder.OptionalString(route.departureRunway);
+    encoder.OptionalString(route.arrivalRunway);
+    encoder.OptionalString(route.suggestedDepartureRunway);
+    encoder.OptionalString(route.suggestedArrivalRunway);
+    encoder.OptionalString(route.sidConnectionWaypoint);
+    encoder.OptionalString(route.starConnectionWaypoint);
+    encoder.ProcedureOrNull(route.SID);
+    encoder.ProcedureOrNull(route.STAR);
+    encoder.ProcedureOrNull(route.suggestedSID);
+    encoder.ProcedureOrNull(route.suggestedSTAR);
+    encoder.Finish(out);
+}
+
+inline void EncodeParsedRoute(const ParsedRoute& route, std::string& out)
+{
+    EncodeCompactRoute(CompactParsedRoute::FromParsedRoute(route), out);
+}
+
+/**
+ * @brief Decodes a route written by EncodeCompactRoute or EncodeParsedRoute.
+ * @throws RouteDecodeException if the data is not a valid encoded route.
+ */
+inline CompactParsedRoute DecodeCompactRoute(std::string_view data)
+{
+    RouteCodec::Decoder decoder(data);
+    CompactParsedRoute route;
+    route.rawRoute = decoder.String();
+    route.totalTokens = decoder.Int();
+    route.waypointPool.resize(decoder.Count());
+    for (auto& waypoint : route.waypointPool) {
+        waypoint = decoder.PoolWaypoint();
+    }
+    const auto poolSize = route.waypointPool.size();
+    route.waypoints = decoder.Indices(poolSize);
+    route.segments = decoder.Segments(route);
+    route.explicitWaypoints = decoder.Indices(poolSize);
+    route.explicitSegments = decoder.Segments(route);
+    const auto errorCount = decoder.Count();
+    for (size_t i = 0; i < errorCount; i++) {
+        route.errors.push_back(decoder.Error());
+    }
+    route.departureRunway = decoder.OptionalString();
+    route.arrivalRunway = decoder.OptionalString();
+    route.suggestedDepartureRunway = decoder.OptionalString();
+    route.suggestedArrivalRunway = decoder.OptionalString();
+    route.sidConnectionWaypoint = decoder.OptionalString();
+    route.starConnectionWaypoint = decoder.OptionalString();
+    route.SID = decoder.ProcedureOrNull();
+    route.STAR = decoder.ProcedureOrNull();
+    route.suggestedSID = decoder.ProcedureOrNull();
+    route.suggestedSTAR = decoder.ProcedureOrNull();
+    if (!decoder.AtEnd()) {
+        throw RouteDecodeException("Trailing data after encoded route");
+    }
+    return route;
+}
+
+inline ParsedRoute DecodeParsedRoute(std::string_view data)
+{
+    return DecodeCompactRoute(data).ToParsedRoute();
+}
+
+} // namespace RouteParser
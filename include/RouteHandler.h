@@ -3,10 +3,21 @@
 #include "Log.h"
 #include "Navdata.h"
 #include "Parser.h"
+#include "ThreadPool.h"
+#include "WarmStart.h"
+#include "types/BootstrapOptions.h"
+#include "types/BootstrapReport.h"
+#include "types/MemoryUsage.h"
 #include "types/Procedure.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 #include <types/Waypoint.h>
 #include <unordered_map>
 using namespace RouteParser;
@@ -31,25 +42,245 @@ public:
     std::shared_ptr<RouteParser::AirportConfigurator> GetAirportConfigurator();
 
     void Bootstrap(ILogger logFunc, std::string navdataDbFile,
-        std::vector<Procedure> procedures, std::string airwaysDbFile)
+        std::vector<Procedure> procedures, std::string airwaysDbFile,
+        const BootstrapOptions& options = {})
     {
         Log::SetLogger(logFunc);
-        navdata->SetProcedures(procedures);
+        WaitUntilLoaded();
+        // Saves the keys of the previous navdata
+        bootstrap->warmStartSaver.reset();
+        bootstrap->isReady = false;
 
-        navdata->LoadAirwayNetwork(airwaysDbFile);
-        navdata->LoadWaypoints(navdataDbFile);
-        navdata->LoadAirports(navdataDbFile);
-        navdata->LoadRunways(navdataDbFile);
+        // A fresh record, loaders of a previous bootstrap have all finished
+        auto progress = std::make_shared<BootstrapProgress>();
+        progress->report.mode = options.mode;
+        progress->report.loaders = { { "procedures" }, { "airways" }, { "waypoints" },
+            { "airports" }, { "runways" } };
+        progress->remaining = progress->report.loaders.size();
+        bootstrap->progress = progress;
 
+        auto navdata = this->navdata;
+        RunLoader(progress, Procedures, [&]() { navdata->SetProcedures(procedures); });
+        {
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            progress->report.loaders[Procedures].rows = procedures.size();
+        }
+
+        auto airways = [progress, navdata, airwaysDbFile]() {
+            RunLoader(progress, Airways, [&]() { navdata->LoadAirwayNetwork(airwaysDbFile); });
+        };
+        auto waypoints = [progress, navdata, navdataDbFile]() {
+            RunLoader(progress, Waypoints, [&]() { navdata->LoadWaypoints(navdataDbFile); });
+        };
+        auto airports = [progress, navdata, navdataDbFile]() {
+            RunLoader(progress, Airports, [&]() { navdata->LoadAirports(navdataDbFile); });
+        };
+        auto runways = [progress, navdata, navdataDbFile]() {
+            RunLoader(progress, Runways, [&]() { navdata->LoadRunways(navdataDbFile); });
+        };
+
+        std::vector<std::shared_future<void>> networksLoaded;
+        if (options.mode == BootstrapMode::Sequential) {
+            airways();
+            waypoints();
+            airports();
+            runways();
+        } else {
+            // Each network opens its own database, they load independently
+            std::future<void> airwaysLoaded;
+            std::future<void> waypointsLoaded;
+            {
+                std::lock_guard<std::mutex> lock(bootstrap->mutex);
+                auto& pool = bootstrap->pool;
+                pool = std::make_unique<ThreadPool>(options.threads ? options.threads : 4);
+                airwaysLoaded = pool->Submit(airways);
+                waypointsLoaded = pool->Submit(waypoints);
+                networksLoaded.push_back(pool->Submit(airports).share());
+                networksLoaded.push_back(pool->Submit(runways).share());
+                bootstrap->pending = networksLoaded;
+            }
+
+            // Airways and waypoints are all parsing needs
+            airwaysLoaded.get();
+            waypointsLoaded.get();
+            if (options.mode == BootstrapMode::Parallel) {
+                WaitUntilLoaded();
+            }
+        }
+
+        if (!options.warmStartFile.empty()) {
+            StartWarmStart(options, std::move(networksLoaded));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            progress->report.readyMilliseconds
+                = MillisecondsSince(progress->started, std::chrono::steady_clock::now());
+        }
         Log::info("RouteHandler is ready.");
-        this->isReady = true;
+        bootstrap->isReady = true;
+
+        StartRowCounts(progress,
+            { { Airways, airwaysDbFile, "direct_segments" },
+                { Waypoints, navdataDbFile, "navaids" }, { Airports, navdataDbFile, "airports" },
+                { Runways, navdataDbFile, "runways" } });
+    }
+
+    bool IsReady() const { return bootstrap->isReady; }
+
+    // Waits for the networks a lazy Bootstrap still loads in the background, the row
+    // counts of the report and the warm start prefetch. Any thread may wait.
+    void WaitUntilLoaded()
+    {
+        // Held throughout, a second waiter returns once the first one is done
+        std::lock_guard<std::mutex> waiting(bootstrap->waitMutex);
+        std::vector<std::shared_future<void>> pending;
+        std::unique_ptr<ThreadPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(bootstrap->mutex);
+            pending.swap(bootstrap->pending);
+            pool.swap(bootstrap->pool);
+        }
+        for (auto& loaded : pending) {
+            loaded.get();
+        }
+        // Runs what is still queued before joining
+        pool.reset();
     }
 
-    bool IsReady() { return this->isReady; }
+    /**
+     * @brief Timings of the last Bootstrap and the memory held now. Loaders a lazy
+     * Bootstrap still runs report 0 milliseconds, and rows are 0 until counted in the
+     * background once the handler is ready.
+     */
+    BootstrapReport GetBootstrapReport() const
+    {
+        BootstrapReport report;
+        if (const auto progress = bootstrap->progress) {
+            std::lock_guard<std::mutex> lock(progress->mutex);
+            report = progress->report;
+        }
+        report.memory = MemoryUsage();
+        return report;
+    }
+
+    // Saves the hot cache keys to the warm start file now, false if there is none
+    bool SaveWarmStart()
+    {
+        const auto& saver = bootstrap->warmStartSaver;
+        return saver && WarmStart::Save(saver->GetPath());
+    }
+
+    // Estimated memory held by the navdata, its caches and the parse result cache
+    std::vector<MemoryUsageEntry> MemoryUsage() const
+    {
+        auto usage = NavdataObject::MemoryUsage();
+        usage.push_back(parser->GetResultCacheMemoryUsage());
+        return usage;
+    }
 
 private:
+    enum LoaderSlot { Procedures, Airways, Waypoints, Airports, Runways };
+
+    // Filled by the loaders, which may outlive the handler
+    struct BootstrapProgress {
+        std::mutex mutex;
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        BootstrapReport report;
+        size_t remaining = 0;
+    };
+
+    // Shared by copies of the handler, background loading ends with the last one
+    struct BootstrapState {
+        // Destroyed last, the final save sees what the prefetch loaded
+        std::unique_ptr<WarmStart::PeriodicSaver> warmStartSaver;
+        std::atomic<bool> isReady = false;
+        // Guards the pending work and its pool
+        std::mutex mutex;
+        std::mutex waitMutex;
+        std::vector<std::shared_future<void>> pending;
+        std::unique_ptr<ThreadPool> pool;
+        std::shared_ptr<BootstrapProgress> progress;
+    };
+
+    static double MillisecondsSince(std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Table a loader reads, counted for the report
+    struct RowSource {
+        LoaderSlot slot;
+        std::string dbPath;
+        std::string table;
+    };
+
+    static void RunLoader(const std::shared_ptr<BootstrapProgress>& progress, LoaderSlot slot,
+        const std::function<void()>& load)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        load();
+        const auto finished = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        progress->report.loaders[slot].milliseconds = MillisecondsSince(started, finished);
+        if (--progress->remaining == 0) {
+            progress->report.totalMilliseconds = MillisecondsSince(progress->started, finished);
+        }
+    }
+
+    // Runs the background work of a Bootstrap, one thread unless loaders still use it.
+    // Called with the bootstrap mutex held.
+    ThreadPool& BackgroundPool()
+    {
+        auto& pool = bootstrap->pool;
+        if (!pool) {
+            pool = std::make_unique<ThreadPool>(1);
+        }
+        return *pool;
+    }
+
+    // Counting reopens every database, it only updates the report once ready
+    void StartRowCounts(
+        const std::shared_ptr<BootstrapProgress>& progress, std::vector<RowSource> sources)
+    {
+        std::lock_guard<std::mutex> lock(bootstrap->mutex);
+        bootstrap->pending.push_back(BackgroundPool()
+                .Submit([progress, sources = std::move(sources)]() {
+                    for (const auto& source : sources) {
+                        const auto rows = CountRows(source.dbPath, source.table);
+                        std::lock_guard<std::mutex> lock(progress->mutex);
+                        progress->report.loaders[source.slot].rows = rows;
+                    }
+                })
+                .share());
+    }
+
+    // Prefetches the saved keys once the networks they need are loaded
+    void StartWarmStart(const BootstrapOptions& options,
+        std::vector<std::shared_future<void>> networksLoaded)
+    {
+        if (auto keys = WarmStart::Load(options.warmStartFile)) {
+            // Queued behind the loaders, waiting on them cannot starve the pool
+            std::lock_guard<std::mutex> lock(bootstrap->mutex);
+            bootstrap->pending.push_back(BackgroundPool().Submit(
+                [keys = std::move(*keys), networksLoaded = std::move(networksLoaded)]() {
+                    for (const auto& loaded : networksLoaded) {
+                        loaded.wait();
+                    }
+                    WarmStart::Prefetch(keys);
+                }).share());
+        }
+        bootstrap->warmStartSaver = std::make_unique<WarmStart::PeriodicSaver>(
+            options.warmStartFile, options.warmStartSaveInterval);
+    }
+
+    // Rows of a table, 0 if the database or table cannot be read
+    static size_t CountRows(const std::string& dbPath, const std::string& table);
+
     std::shared_ptr<RouteParser::ParserHandler> parser = nullptr;
     std::shared_ptr<RouteParser::NavdataObject> navdata = nullptr;
     std::shared_ptr<RouteParser::AirportConfigurator> airportConfigurator = nullptr;
-    bool isReady = false;
+    std::shared_ptr<BootstrapState> bootstrap = std::make_shared<BootstrapState>();
 };
\ No newline at end of file
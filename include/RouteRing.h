@@ -0,0 +1,293 @@
+#pragma once
+#include "Log.h"
+#include "RouteCodec.h"
+#include "TemporaryPath.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mio/mmap.hpp>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+namespace RouteParser {
+
+/**
+ * @brief Layout of a shared route ring, a file mapped by one writer and any number
+ * of readers, in this process or others.
+ *
+ * The file is a header followed by fixed size slots, route n going to slot
+ * n % slotCount. A slot holds the route in the RouteCodec format, which only uses
+ * offsets, so the mapping can live at any address. Each slot is guarded by a
+ * sequence lock: odd while the writer fills it, even once it is consistent.
+ */
+namespace RouteRingLayout {
+    inline constexpr char Magic[8] = "RPRING1";
+    inline constexpr size_t Alignment = 64;
+
+    struct Header {
+        char magic[8];
+        uint32_t slotCount;
+        uint32_t slotSize;
+        // Number of routes published so far
+        std::atomic<uint64_t> published;
+    };
+
+    struct alignas(Alignment) Slot {
+        std::atomic<uint64_t> sequence;
+        uint64_t routeNumber;
+        uint32_t length;
+    };
+
+    inline constexpr size_t HeaderSize = (sizeof(Header) + Alignment - 1) / Alignment * Alignment;
+    static_assert(std::atomic<uint64_t>::is_always_lock_free,
+        "Shared memory needs lock free 64 bit atomics");
+
+    inline size_t FileSize(uint32_t slotCount, uint32_t slotSize)
+    {
+        return HeaderSize + size_t { slotCount } * slotSize;
+    }
+} // namespace RouteRingLayout
+
+/**
+ * @class RouteRingWriter
+ * @brief Publishes parse results into a shared route ring, overwriting the oldest.
+ *
+ * Only one writer may publish into a ring at a time. Publishing never waits for
+ * readers, readers that fall behind by more than the ring size miss routes.
+ */
+class RouteRingWriter {
+public:
+    /**
+     * @brief Creates the ring file, replacing any previous one.
+     *
+     * The ring is built aside and renamed over the previous one, so readers still
+     * attached to that one keep reading it instead of seeing it change size under
+     * their mapping.
+     * @param slotSize Bytes per slot, including a 64 byte slot header. Routes that
+     * do not fit are not published.
+     */
+    RouteRingWriter(const std::string& path, uint32_t slotCount = 1024, uint32_t slotSize = 4096)
+    {
+        using namespace RouteRingLayout;
+        slotSize = (std::max<uint32_t>(slotSize, 2 * Alignment) + Alignment - 1) / Alignment
+            * Alignment;
+        if (slotCount == 0) {
+            Log::error("Failed to create route ring {}: no slots", path);
+            return;
+        }
+
+        const auto temporaryPath = TemporaryPathFor(path);
+        std::error_code error;
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        }
+        std::filesystem::resize_file(temporaryPath, FileSize(slotCount, slotSize), error);
+        if (!error) {
+            mapping = mio::make_mmap_sink(temporaryPath, 0, mio::map_entire_file, error);
+        }
+        if (error) {
+            Log::error("Failed to create route ring {}: {}", path, error.message());
+            mapping = {};
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+
+        // A fresh file is zeroed, which is a valid empty ring
+        auto* header = new (mapping.data()) RouteRingLayout::Header {};
+        header->slotCount = slotCount;
+        header->slotSize = slotSize;
+        for (uint32_t i = 0; i < slotCount; i++) {
+            new (SlotAt(i)) RouteRingLayout::Slot {};
+        }
+        // Readers check the magic last
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header->magic, Magic, sizeof(Magic));
+
+        // The mapping stays valid, it follows the file to its new name
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            Log::error("Failed to replace route ring {}: {}", path, error.message());
+            mapping = {};
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+    bool IsOpen() const { return mapping.is_open(); }
+
+    /**
+     * @brief Publishes a route, its explicit route is generated if not done yet.
+     * @return Whether it was published, false when it does not fit in a slot.
+     */
+    bool Publish(const ParsedRoute& route)
+    {
+        if (!IsOpen()) {
+            return false;
+        }
+        encoded.clear();
+        EncodeParsedRoute(route, encoded);
+        auto* header = GetHeader();
+        if (encoded.size() > header->slotSize - sizeof(RouteRingLayout::Slot)) {
+            Log::warn("Route of {} bytes does not fit the route ring slots of {} bytes",
+                encoded.size(), header->slotSize);
+            return false;
+        }
+
+        const auto number = header->published.load(std::memory_order_relaxed);
+        auto* slot = SlotAt(number % header->slotCount);
+        const auto sequence = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->routeNumber = number;
+        slot->length = static_cast<uint32_t>(encoded.size());
+        std::memcpy(reinterpret_cast<char*>(slot + 1), encoded.data(), encoded.size());
+        slot->sequence.store(sequence + 2, std::memory_order_release);
+        header->published.store(number + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t Published() const
+    {
+        return IsOpen() ? GetHeader()->published.load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    RouteRingLayout::Header* GetHeader() const
+    {
+        return reinterpret_cast<RouteRingLayout::Header*>(
+            const_cast<char*>(mapping.data()));
+    }
+
+    RouteRingLayout::Slot* SlotAt(uint64_t index) const
+    {
+        return reinterpret_cast<RouteRingLayout::Slot*>(const_cast<char*>(mapping.data())
+            + RouteRingLayout::HeaderSize + index * GetHeader()->slotSize);
+    }
+
+    mio::mmap_sink mapping;
+    // Reused between publications
+    std::string encoded;
+};
+
+/**
+ * @class RouteRingReader
+ * @brief Reads routes from a shared route ring, straight from the mapping.
+ */
+class RouteRingReader {
+public:
+    explicit RouteRingReader(const std::string& path)
+    {
+        using namespace RouteRingLayout;
+        std::error_code error;
+        mapping = mio::make_mmap_source(path, 0, mio::map_entire_file, error);
+        if (error || mapping.size() < HeaderSize
+            || std::memcmp(GetHeader()->magic, Magic, sizeof(Magic)) != 0) {
+            Log::error("Failed to attach to route ring {}", path);
+            mapping = {};
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto* header = GetHeader();
+        if (header->slotCount == 0 || header->slotSize < 2 * Alignment
+            || header->slotSize % Alignment != 0) {
+            Log::error("Route ring {} has an invalid layout", path);
+            mapping = {};
+            return;
+        }
+        if (mapping.size() < FileSize(header->slotCount, header->slotSize)) {
+            Log::error("Route ring {} is truncated", path);
+            mapping = {};
+        }
+    }
+
+    bool IsOpen() const { return mapping.is_open(); }
+
+    uint64_t Published() const
+    {
+        return IsOpen() ? GetHeader()->published.load(std::memory_order_acquire) : 0;
+    }
+
+    // Oldest route still in the ring
+    uint64_t Oldest() const
+    {
+        const auto published = Published();
+        const auto slotCount = IsOpen() ? GetHeader()->slotCount : 0;
+        return published > slotCount ? published - slotCount : 0;
+    }
+
+    /**
+     * @brief Passes the encoded route to the visitor without copying it.
+     *
+     * The writer may overwrite the slot meanwhile, so the visitor must cope with
+     * inconsistent bytes, and what it got is only to be used if this returns true.
+     * @return Whether the route was read consistently, false if it was not
+     * published yet or was overwritten.
+     */
+    template <typename Visitor> bool Visit(uint64_t number, Visitor&& visitor) const
+    {
+        if (!IsOpen() || number >= Published()) {
+            return false;
+        }
+        const auto* header = GetHeader();
+        const auto* slot = SlotAt(number % header->slotCount);
+        const auto capacity = header->slotSize - sizeof(RouteRingLayout::Slot);
+        // Bounded, a writer that died mid publication leaves the slot odd
+        for (int attempt = 0; attempt < MaxAttempts; attempt++) {
+            const auto before = slot->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            const auto routeNumber = slot->routeNumber;
+            if (routeNumber == number) {
+                visitor(std::string_view(reinterpret_cast<const char*>(slot + 1),
+                    std::min<size_t>(slot->length, capacity)));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->sequence.load(std::memory_order_relaxed) == before) {
+                return routeNumber == number;
+            }
+        }
+        return false;
+    }
+
+    // Decodes a route, nullopt if it is not available
+    std::optional<ParsedRoute> Read(uint64_t number) const
+    {
+        std::optional<ParsedRoute> route;
+        const bool consistent = Visit(number, [&route](std::string_view bytes) {
+            try {
+                route = DecodeParsedRoute(bytes);
+            } catch (const std::exception&) {
+                // Torn read, retried by Visit, or a corrupt slot
+                route.reset();
+            }
+        });
+        return consistent ? route : std::nullopt;
+    }
+
+private:
+    static constexpr int MaxAttempts = 1000;
+
+    const RouteRingLayout::Header* GetHeader() const
+    {
+        return reinterpret_cast<const RouteRingLayout::Header*>(mapping.data());
+    }
+
+    const RouteRingLayout::Slot* SlotAt(uint64_t index) const
+    {
+        return reinterpret_cast<const RouteRingLayout::Slot*>(
+            mapping.data() + RouteRingLayout::HeaderSize + index * GetHeader()->slotSize);
+    }
+
+    mio::mmap_source mapping;
+};
+
+} // namespace RouteParser
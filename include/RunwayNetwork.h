@@ -1,7 +1,9 @@
 #pragma once
 #include "Runway.h"
+#include "types/MemoryUsage.h"
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -24,6 +26,11 @@ namespace RouteParser
 
         void clearCache() noexcept;
 
+        MemoryUsageEntry memoryUsage() const;
+
+        // Airports whose runways are cached
+        std::vector<std::string> cachedKeys() const;
+
     private:
         bool isValidDbPath(const std::string& path) noexcept;
         bool openDatabase();
@@ -35,6 +42,8 @@ namespace RouteParser
         bool isInitialized_ = false;
         std::unique_ptr<SQLite::Database> db_;
 
+        // Lookups may run on several threads
+        mutable std::mutex cacheMutex_;
         std::unordered_map<std::string, std::vector<Runway>> cache_;
     };
 }
\ No newline at end of file
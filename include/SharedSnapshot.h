@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace RouteParser {
+
+/**
+ * @class SharedSnapshot
+ * @brief A shared_ptr that readers load while writers replace it, without readers
+ * ever taking a lock.
+ *
+ * std::atomic<std::shared_ptr> is missing from libc++ and takes a lock in libstdc++.
+ * Here a reader registers in the counter of the current epoch, copies the pointer and
+ * leaves. A writer publishes the new value, moves to the next epoch and waits until
+ * the readers of the previous one are gone before releasing the old value. Writers
+ * are serialised and meant to be rare, as with the navdata networks and runway
+ * configurations held this way.
+ */
+template <typename T> class SharedSnapshot {
+public:
+    SharedSnapshot(std::shared_ptr<T> value = nullptr)
+        : current(new Node { std::move(value) })
+    {
+    }
+
+    SharedSnapshot(const SharedSnapshot&) = delete;
+    SharedSnapshot& operator=(const SharedSnapshot&) = delete;
+
+    ~SharedSnapshot() { delete current.load(); }
+
+    std::shared_ptr<T> load() const
+    {
+        while (true) {
+            const auto epoch = this->epoch.load();
+            auto& readers = this->readers[epoch & 1];
+            readers.fetch_add(1);
+            // A writer moved on meanwhile and may not wait for this reader
+            if (this->epoch.load() != epoch) {
+                readers.fetch_sub(1);
+                continue;
+            }
+            auto value = current.load()->value;
+            readers.fetch_sub(1);
+            return value;
+        }
+    }
+
+    void store(std::shared_ptr<T> value)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const auto* previous = current.exchange(new Node { std::move(value) });
+        const auto epoch = this->epoch.fetch_add(1);
+        // Readers of the previous epoch may still be copying the previous value
+        while (readers[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+        delete previous;
+    }
+
+    SharedSnapshot& operator=(std::shared_ptr<T> value)
+    {
+        store(std::move(value));
+        return *this;
+    }
+
+private:
+    struct Node {
+        std::shared_ptr<T> value;
+    };
+
+    std::atomic<Node*> current;
+    std::atomic<uint64_t> epoch = 0;
+    mutable std::array<std::atomic<uint64_t>, 2> readers {};
+    std::mutex writeMutex;
+};
+
+} // namespace RouteParser
@@ -16,7 +16,7 @@ namespace RouteParser {
 struct FoundProcedure {
     std::optional<std::string> procedure;
     std::optional<std::string> runway;
-    std::optional<RouteParser::Procedure> extractedProcedure;
+    RouteParser::ProcedurePtr extractedProcedure;
     std::vector<RouteParser::ParsingError> errors;
 };
 
@@ -41,30 +41,16 @@ public:
             const std::string& runway = parsedRoute.departureRunway.value();
             const std::string& firstWaypoint = waypointIds[0];
 
-            auto airportProcedures = NavdataObject::GetProceduresByAirport(origin);
-            const auto& procedures = NavdataObject::GetProcedures();
-
-            for (size_t idx : airportProcedures) {
-                const auto& procedure = procedures[idx];
-                if (procedure.type == PROCEDURE_SID && procedure.runway == runway) {
-                    for (const auto& procWpt : procedure.waypoints) {
-                        if (procWpt.getIdentifier() == firstWaypoint) {
-                            parsedRoute.suggestedDepartureRunway = runway;
-                            parsedRoute.suggestedSID = procedure;
-
-                            parsedRoute.errors.push_back(
-                                { ParsingErrorType::NO_PROCEDURE_FOUND,
-                                    "Suggesting SID " + procedure.name + " for runway "
-                                        + runway,
-                                    0, origin, ParsingErrorLevel::INFO });
-
-                            break;
-                        }
-                    }
+            for (const auto& procedure :
+                NavdataObject::GetProceduresByFix(origin, PROCEDURE_SID, firstWaypoint)) {
+                if (procedure->runway == runway) {
+                    parsedRoute.suggestedDepartureRunway = runway;
+                    parsedRoute.suggestedSID = procedure;
 
-                    if (parsedRoute.suggestedSID.has_value()) {
-                        break;
-                    }
+                    parsedRoute.errors.push_back({ ParsingErrorType::NO_PROCEDURE_FOUND,
+                        MESSAGE_SUGGESTING_SID, { procedure->name, runway }, 0, origin,
+                        ParsingErrorLevel::INFO });
+                    break;
                 }
             }
 
@@ -72,13 +58,12 @@ public:
             auto sidSuggestion = airportConfigurator->FindBestSID(origin, waypointIds);
             if (sidSuggestion) {
                 parsedRoute.suggestedDepartureRunway = sidSuggestion->first;
-                std::optional<Procedure> procedure = sidSuggestion->second;
+                const ProcedurePtr& procedure = sidSuggestion->second;
 
-                if (procedure.has_value()) {
-                    parsedRoute.suggestedSID = *procedure;
+                if (procedure) {
+                    parsedRoute.suggestedSID = procedure;
                     parsedRoute.errors.push_back({ ParsingErrorType::NO_PROCEDURE_FOUND,
-                        "Suggesting SID " + procedure->name + " for runway "
-                            + sidSuggestion->first,
+                        MESSAGE_SUGGESTING_SID, { procedure->name, sidSuggestion->first },
                         parsedRoute.totalTokens - 1, destination,
                         ParsingErrorLevel::INFO });
                 }
@@ -90,31 +75,17 @@ public:
             const std::string& runway = parsedRoute.arrivalRunway.value();
             const std::string& lastWaypoint = waypointIds.back();
 
-            auto airportProcedures = NavdataObject::GetProceduresByAirport(destination);
-            const auto& procedures = NavdataObject::GetProcedures();
-
-            for (size_t idx : airportProcedures) {
-                const auto& procedure = procedures[idx];
-                if (procedure.type == PROCEDURE_STAR && procedure.runway == runway) {
-                    for (const auto& procWpt : procedure.waypoints) {
-                        if (procWpt.getIdentifier() == lastWaypoint) {
-                            parsedRoute.suggestedArrivalRunway = runway;
-                            parsedRoute.suggestedSTAR = procedure;
-
-                            parsedRoute.errors.push_back(
-                                { ParsingErrorType::NO_PROCEDURE_FOUND,
-                                    "Suggesting STAR " + procedure.name + " for runway "
-                                        + runway,
-                                    parsedRoute.totalTokens - 1, destination,
-                                    ParsingErrorLevel::INFO });
-
-                            break;
-                        }
-                    }
+            for (const auto& procedure : NavdataObject::GetProceduresByFix(
+                     destination, PROCEDURE_STAR, lastWaypoint)) {
+                if (procedure->runway == runway) {
+                    parsedRoute.suggestedArrivalRunway = runway;
+                    parsedRoute.suggestedSTAR = procedure;
 
-                    if (parsedRoute.suggestedSTAR.has_value()) {
-                        break;
-                    }
+                    parsedRoute.errors.push_back({ ParsingErrorType::NO_PROCEDURE_FOUND,
+                        MESSAGE_SUGGESTING_STAR, { procedure->name, runway },
+                        parsedRoute.totalTokens - 1, destination,
+                        ParsingErrorLevel::INFO });
+                    break;
                 }
             }
         } else if (!parsedRoute.arrivalRunway.has_value()) {
@@ -122,13 +93,12 @@ public:
                 = airportConfigurator->FindBestSTAR(destination, waypointIds);
             if (starSuggestion) {
                 parsedRoute.suggestedArrivalRunway = starSuggestion->first;
-                std::optional<Procedure> procedure = starSuggestion->second;
+                const ProcedurePtr& procedure = starSuggestion->second;
 
-                if (procedure.has_value()) {
-                    parsedRoute.suggestedSTAR = *procedure;
+                if (procedure) {
+                    parsedRoute.suggestedSTAR = procedure;
                     parsedRoute.errors.push_back({ ParsingErrorType::NO_PROCEDURE_FOUND,
-                        "Suggesting STAR " + procedure->name + " for runway "
-                            + starSuggestion->first,
+                        MESSAGE_SUGGESTING_STAR, { procedure->name, starSuggestion->first },
                         parsedRoute.totalTokens - 1, destination,
                         ParsingErrorLevel::INFO });
                 }
@@ -153,7 +123,7 @@ public:
     {
         if (token.empty() || anchorIcao.empty()) {
             return FoundProcedure { {}, {}, {},
-                { ParsingError { ParsingErrorType::INVALID_DATA, "Empty token or ICAO",
+                { ParsingError { ParsingErrorType::INVALID_DATA, MESSAGE_EMPTY_TOKEN, {},
                     tokenIndex, token } } };
         }
 
@@ -161,8 +131,9 @@ public:
         const std::vector<std::string> parts = absl::StrSplit(token, '/');
         std::string procedureToken = parts[0];
 
-        bool isProcedurePattern = std::regex_match(
-            procedureToken, std::regex(R"([A-Z]{1,5}\d[A-Z]?(?:.*)?(?:\/\d{2}[LRC]?)?)"));
+        static const std::regex procedurePattern(
+            R"([A-Z]{1,5}\d[A-Z]?(?:.*)?(?:\/\d{2}[LRC]?)?)");
+        bool isProcedurePattern = std::regex_match(procedureToken, procedurePattern);
 
         bool isAirportPattern = (procedureToken.length() == 4
             && std::all_of(procedureToken.begin(), procedureToken.end(),
@@ -175,38 +146,36 @@ public:
             return upper;
         };
 
-        std::vector<RouteParser::Procedure> matchingProcedures;
+        std::vector<RouteParser::ProcedurePtr> matchingProcedures;
         if (isProcedurePattern) {
             auto procedures = NavdataObject::GetProceduresByName(procedureToken);
 
             for (const auto& proc : procedures) {
-                if (proc.icao == anchorIcao && proc.type == type) {
+                if (proc->icao == anchorIcao && proc->type == type) {
                     matchingProcedures.push_back(proc);
                 }
             }
 
             if (!matchingProcedures.empty() && runway) {
                 for (const auto& procedure : matchingProcedures) {
-                    if (procedure.runway == runway.value()) {
+                    if (procedure->runway == runway.value()) {
                         return FoundProcedure { procedureToken, runway, procedure };
                     }
                 }
                 std::string typeStr = (type == PROCEDURE_SID) ? "SID" : "STAR";
-                return FoundProcedure { std::nullopt, std::nullopt, std::nullopt,
+                return FoundProcedure { std::nullopt, std::nullopt, nullptr,
                     { ParsingError { ParsingErrorType::PROCEDURE_RUNWAY_MISMATCH,
-                        fmt::format("No matching runway {} found for procedure {} at {}, "
-                                    "ignoring confirmed {}",
-                            runway.value_or("N/A"), procedureToken, anchorIcao, typeStr),
+                        MESSAGE_PROCEDURE_RUNWAY_MISMATCH,
+                        { runway.value_or("N/A"), procedureToken, anchorIcao, typeStr },
                         tokenIndex, procedureToken, ParsingErrorLevel::PARSE_ERROR } } };
             }
         }
 
         if (isAirportPattern && runway) {
             if (procedureToken != anchorIcao) {
-                return FoundProcedure { std::nullopt, std::nullopt, std::nullopt,
+                return FoundProcedure { std::nullopt, std::nullopt, nullptr,
                     { ParsingError { ParsingErrorType::PROCEDURE_AIRPORT_MISMATCH,
-                        fmt::format("Airport code {} doesn't match expected {}",
-                            procedureToken, anchorIcao),
+                        MESSAGE_PROCEDURE_AIRPORT_MISMATCH, { procedureToken, anchorIcao },
                         tokenIndex, token, ParsingErrorLevel::INFO } } };
             }
             auto runwayNetwork = NavdataObject::GetRunwayNetwork();
@@ -215,18 +184,17 @@ public:
                     procedureToken, runway.value());
 
                 if (!runwayExists) {
-                    return FoundProcedure { std::nullopt, std::nullopt, std::nullopt,
+                    return FoundProcedure { std::nullopt, std::nullopt, nullptr,
                         { ParsingError { ParsingErrorType::INVALID_RUNWAY,
-                            fmt::format("Runway {} not found at airport {}",
-                                runway.value_or("N/A"), procedureToken),
+                            MESSAGE_RUNWAY_NOT_FOUND, { runway.value_or("N/A"), procedureToken },
                             tokenIndex, token, ParsingErrorLevel::PARSE_ERROR } } };
                 }
             }
 
-            return FoundProcedure { std::nullopt, runway, std::nullopt };
+            return FoundProcedure { std::nullopt, runway, nullptr };
         }
 
-        return FoundProcedure { std::nullopt, std::nullopt, std::nullopt };
+        return FoundProcedure { std::nullopt, std::nullopt, nullptr };
     }
 };
 }; // namespace RouteParser
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace RouteParser {
+
+/**
+ * @class Task
+ * @brief Lazy coroutine producing a T, started when awaited.
+ *
+ * The awaiting coroutine is resumed on whatever thread the task completes on. Use
+ * SyncWait to get the result from code that is not a coroutine.
+ */
+template <typename T> class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr exception;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept
+        {
+            // Hands the thread over to the awaiting coroutine
+            struct Resume {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    const auto continuation = handle.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() const noexcept { }
+            };
+            return Resume {};
+        }
+
+        template <typename U> void return_value(U&& result)
+        {
+            value.emplace(std::forward<U>(result));
+        }
+
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        auto& promise = handle.promise();
+        if (promise.exception) {
+            std::rethrow_exception(promise.exception);
+        }
+        return std::move(*promise.value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle)
+        : handle(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace Detail {
+    struct SyncWaitState {
+        std::mutex mutex;
+        std::condition_variable completed;
+        bool done = false;
+    };
+
+    // Awaits a task, then wakes the thread blocked in SyncWait
+    struct SyncWaitDriver {
+        struct promise_type {
+            SyncWaitState* state = nullptr;
+
+            SyncWaitDriver get_return_object()
+            {
+                return { std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            auto final_suspend() noexcept
+            {
+                struct Signal {
+                    bool await_ready() const noexcept { return false; }
+                    void await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                    {
+                        // Notified under the lock, the frame may be gone right after
+                        auto* state = handle.promise().state;
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->done = true;
+                        state->completed.notify_one();
+                    }
+                    void await_resume() const noexcept { }
+                };
+                return Signal {};
+            }
+
+            void return_void() { }
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template <typename T>
+    SyncWaitDriver Drive(Task<T>& task, std::optional<T>& result, std::exception_ptr& error)
+    {
+        try {
+            result.emplace(co_await task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+} // namespace Detail
+
+// Runs the task and blocks until it completes, rethrowing what it threw
+template <typename T> T SyncWait(Task<T> task)
+{
+    std::optional<T> result;
+    std::exception_ptr error;
+    Detail::SyncWaitState state;
+    auto driver = Detail::Drive(task, result, error);
+    driver.handle.promise().state = &state;
+    driver.handle.resume();
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.completed.wait(lock, [&state]() { return state.done; });
+    }
+    driver.handle.destroy();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return std::move(*result);
+}
+
+} // namespace RouteParser
@@ -0,0 +1,29 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <fmt/format.h>
+#include <string>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace RouteParser {
+
+/**
+ * @brief Path of a file to write next to path, then rename over it. Unique per
+ * process and call, several processes or threads may replace the same file at once.
+ */
+inline std::string TemporaryPathFor(const std::string& path)
+{
+    static std::atomic<uint64_t> counter = 0;
+#ifdef _WIN32
+    const auto processId = _getpid();
+#else
+    const auto processId = getpid();
+#endif
+    return fmt::format("{}.{}.{}.tmp", path, processId, counter++);
+}
+
+} // namespace RouteParser
@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads running submitted tasks in order.
+ *
+ * Destroying the pool runs the tasks still queued, then joins the workers.
+ */
+class ThreadPool {
+public:
+    // 0 for one thread per hardware thread
+    explicit ThreadPool(size_t threadCount = 0)
+    {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this]() { Work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Runs the task on a worker, its result or exception is delivered by the future
+    template <typename Task> auto Submit(Task task) -> std::future<std::invoke_result_t<Task>>
+    {
+        using Result = std::invoke_result_t<Task>;
+        // Shared, std::function needs a copyable callable
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        auto future = packaged->get_future();
+        Post([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    // Runs the task on a worker, without a way to wait for it
+    void Post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+    size_t ThreadCount() const { return workers.size(); }
+
+private:
+    void Work()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+} // namespace RouteParser
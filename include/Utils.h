@@ -8,9 +8,11 @@
 #include "absl/strings/match.h"
 #include "absl/strings/string_view.h"
 #include "types/ParsingError.h"
+#include "types/ParsingErrorCollector.h"
 #include "types/RouteWaypoint.h"
 #include <optional>
 #include <string>
+#include <string_view>
 #include "Regexes.h"
 #include <ctre.hpp>
 #include <regex>
@@ -19,33 +21,33 @@ namespace RouteParser
   namespace Utils
   {
    
-    static std::string DetermineTokenType(const std::string& token) {
+    static std::string_view DetermineTokenType(std::string_view token) {
         // ATS route pattern (as described):
         // [prefix?][letter][number]
         // Prefix: K, U, S (optional)
         // Letter: A,B,G,R,L,M,N,P,H,J,V,W,Q,T,Y,Z
         // Number: 1-999
-        std::regex airwayPattern(R"(^(?:[KUS])?[ABGRLMNPHJVWQTYZ]\d{1,3}[FG]?$)");
+        static const std::regex airwayPattern(R"(^(?:[KUS])?[ABGRLMNPHJVWQTYZ]\d{1,3}[FG]?$)");
 
         // Airport ICAO codes are 4 letters
-        std::regex airportPattern(R"(^[A-Z]{4}$)");
+        static const std::regex airportPattern(R"(^[A-Z]{4}$)");
 
         // VOR/NDB typically 2-3 letters
-        std::regex vorNdbPattern(R"(^[A-Z]{2,3}$)");
+        static const std::regex vorNdbPattern(R"(^[A-Z]{2,3}$)");
 
         // Waypoint/Fix typically 5 letters
-        std::regex fixPattern(R"(^[A-Z]{5}$)");
+        static const std::regex fixPattern(R"(^[A-Z]{5}$)");
 
-        if (std::regex_match(token, airwayPattern)) {
+        if (std::regex_match(token.begin(), token.end(), airwayPattern)) {
             return "AIRWAY";
         }
-        else if (std::regex_match(token, airportPattern)) {
+        else if (std::regex_match(token.begin(), token.end(), airportPattern)) {
             return "AIRPORT";
         }
-        else if (std::regex_match(token, vorNdbPattern)) {
+        else if (std::regex_match(token.begin(), token.end(), vorNdbPattern)) {
             return "NAVAID";
         }
-        else if (std::regex_match(token, fixPattern)) {
+        else if (std::regex_match(token.begin(), token.end(), fixPattern)) {
             return "FIX";
         }
         else {
@@ -152,23 +154,12 @@ namespace RouteParser
           waypoint.getFrequencyHz(), currentFlightRule, plannedPosition);
     }
 
+    // Kept for existing callers, see ParsingErrorCollector::InsertIfNotDuplicate
     static void InsertParsingErrorIfNotDuplicate(
-        std::vector<ParsingError> &parsingErrors,
+        ParsingErrorCollector &parsingErrors,
         const ParsingError &error)
     {
-      auto it = std::find_if(parsingErrors.begin(), parsingErrors.end(),
-                             [&error](const ParsingError &existingError)
-                             {
-                               return existingError.level == error.level &&
-                                      existingError.message == error.message &&
-                                      existingError.tokenIndex == error.tokenIndex &&
-                                      existingError.token == error.token &&
-                                      existingError.type == error.type;
-                             });
-      if (it == parsingErrors.end())
-      {
-        parsingErrors.push_back(error);
-      }
+      parsingErrors.InsertIfNotDuplicate(error);
     }
 
     static WaypointType GetWaypointTypeByIdentifier(std::string identifier)
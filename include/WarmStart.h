@@ -0,0 +1,191 @@
+#pragma once
+#include "Log.h"
+#include "Navdata.h"
+#include "TemporaryPath.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @brief Hot identifiers of the lookup caches, saved to a file so a restarted
+ * process can refill its caches before the first route needs them.
+ *
+ * Only the identifiers are saved, never the resolved entries: they stay valid
+ * across navdata updates, and prefetching resolves them against the navdata
+ * loaded now.
+ */
+namespace WarmStart {
+    inline constexpr uint32_t Version = 1;
+
+    struct HotKeys {
+        uint32_t version = Version;
+        std::vector<std::string> waypoints;
+        std::vector<std::string> airports;
+        std::vector<std::string> runways;
+
+        size_t Size() const { return waypoints.size() + airports.size() + runways.size(); }
+
+        NLOHMANN_DEFINE_TYPE_INTRUSIVE(HotKeys, version, waypoints, airports, runways)
+    };
+
+    // Keys currently in the waypoint, airport and runway caches
+    inline HotKeys Collect()
+    {
+        HotKeys keys;
+        if (const auto waypoints = NavdataObject::GetWaypointNetwork()) {
+            keys.waypoints = waypoints->cachedKeys();
+        }
+        if (const auto airports = NavdataObject::GetAirportNetwork()) {
+            keys.airports = airports->cachedKeys();
+        }
+        if (const auto runways = NavdataObject::GetRunwayNetwork()) {
+            keys.runways = runways->cachedKeys();
+        }
+        return keys;
+    }
+
+    // Written next to the file then renamed over it, readers never see half a file
+    inline bool Save(const HotKeys& keys, const std::string& path)
+    {
+        const auto temporaryPath = TemporaryPathFor(path);
+        std::error_code error;
+        {
+            std::ofstream file(temporaryPath, std::ios::trunc);
+            file << nlohmann::json(keys).dump();
+            file.close();
+            if (!file) {
+                Log::error("Failed to write warm start file {}", temporaryPath);
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            Log::error("Failed to replace warm start file {}: {}", path, error.message());
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    inline bool Save(const std::string& path)
+    {
+        const auto keys = Collect();
+        if (!Save(keys, path)) {
+            return false;
+        }
+        Log::info("Saved {} warm start keys to {}", keys.Size(), path);
+        return true;
+    }
+
+    // nullopt when the file is missing, unreadable or of another version
+    inline std::optional<HotKeys> Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file) {
+            return std::nullopt;
+        }
+        try {
+            auto keys = nlohmann::json::parse(file).get<HotKeys>();
+            if (keys.version != Version) {
+                Log::warn("Ignoring warm start file {} of version {}", path, keys.version);
+                return std::nullopt;
+            }
+            return keys;
+        } catch (const nlohmann::json::exception& e) {
+            Log::warn("Ignoring unreadable warm start file {}: {}", path, e.what());
+            return std::nullopt;
+        }
+    }
+
+    // Looks every key up, filling the caches of the loaded networks
+    inline void Prefetch(const HotKeys& keys)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        if (const auto waypoints = NavdataObject::GetWaypointNetwork()) {
+            for (const auto& identifier : keys.waypoints) {
+                waypoints->findWaypoint(identifier);
+            }
+        }
+        if (const auto airports = NavdataObject::GetAirportNetwork()) {
+            for (const auto& ident : keys.airports) {
+                airports->findAirport(ident);
+            }
+        }
+        if (const auto runways = NavdataObject::GetRunwayNetwork()) {
+            for (const auto& airport : keys.runways) {
+                runways->findRunwaysByAirport(airport);
+            }
+        }
+        Log::info("Prefetched {} warm start keys in {} ms", keys.Size(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started)
+                .count());
+    }
+
+    /**
+     * @class PeriodicSaver
+     * @brief Saves the hot keys on a timer, and once more when destroyed.
+     */
+    class PeriodicSaver {
+    public:
+        // An interval of 0 only saves on destruction
+        PeriodicSaver(std::string path, std::chrono::seconds interval)
+            : path(std::move(path))
+            , interval(interval)
+        {
+            if (interval.count() > 0) {
+                thread = std::thread([this]() { Run(); });
+            }
+        }
+
+        PeriodicSaver(const PeriodicSaver&) = delete;
+        PeriodicSaver& operator=(const PeriodicSaver&) = delete;
+
+        ~PeriodicSaver()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wakeUp.notify_all();
+            if (thread.joinable()) {
+                thread.join();
+            }
+            Save(path);
+        }
+
+        const std::string& GetPath() const { return path; }
+
+    private:
+        void Run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wakeUp.wait_for(lock, interval, [this]() { return stopping; })) {
+                lock.unlock();
+                Save(path);
+                lock.lock();
+            }
+        }
+
+        const std::string path;
+        const std::chrono::seconds interval;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        bool stopping = false;
+        std::thread thread;
+    };
+} // namespace WarmStart
+
+} // namespace RouteParser
@@ -1,11 +1,17 @@
 #pragma once
 #include <SQLiteCpp/SQLiteCpp.h>
+#include "ConnectionPool.h"
+#include "SharedSnapshot.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <filesystem>
 #include <algorithm>
+#include "types/MemoryUsage.h"
 #include "types/Waypoint.h"
 #include "erkir/geo/sphericalpoint.h"
 #include "Log.h"
@@ -32,6 +38,9 @@ namespace RouteParser
         virtual bool isInitialized() const = 0;
         virtual std::string getName() const = 0;
         virtual int getPriority() const = 0;
+
+        // Memory held by the provider itself, 0 for providers reading a database
+        virtual MemoryUsageEntry memoryUsage() const { return { getName(), 0, 0 }; }
     };
 
     class NseWaypointProvider : public WaypointProvider {
@@ -134,12 +143,24 @@ namespace RouteParser
         std::string getName() const override { return name; }
 
         int getPriority() const override { return priority; }
+
+        MemoryUsageEntry memoryUsage() const override
+        {
+            size_t waypoints = 0;
+            for (const auto& [identifier, identifierWaypoints] : waypointsByIdentifier) {
+                waypoints += identifierWaypoints.size();
+            }
+            return { name, waypoints, MemoryEstimate::HeapBytes(waypointsByIdentifier) };
+        }
     };
 
     class BaseWaypointProvider : public WaypointProvider
     {
     protected:
+        // Only used to validate the database, then handed over to the connections
         std::unique_ptr<SQLite::Database> db;
+        // Lookups may run on several threads, each leases its own connection
+        std::unique_ptr<ConnectionPool> connections;
         std::string dbPath;
         std::string name;
         bool initialized{false};
@@ -176,7 +197,7 @@ namespace RouteParser
 
         bool isInitialized() const override
         {
-            return initialized && db != nullptr;
+            return initialized && connections != nullptr;
         }
 
         std::string getName() const override
@@ -209,6 +230,7 @@ namespace RouteParser
                     initialized = false;
                     return false;
                 }
+                connections = std::make_unique<ConnectionPool>(dbPath, std::move(db));
 
                 Log::info("[{}] Successfully initialized database provider (Priority: {})",
                     name, priority);
@@ -307,7 +329,8 @@ namespace RouteParser
 
             try
             {
-                SQLite::Statement query(*db, "SELECT identifier, latitude, longitude FROM waypoints WHERE identifier = ?");
+                const auto connection = connections->Acquire();
+                SQLite::Statement query(*connection, "SELECT identifier, latitude, longitude FROM waypoints WHERE identifier = ?");
                 query.bind(1, identifier);
 
                 while (query.executeStep())
@@ -352,7 +375,8 @@ namespace RouteParser
 
             try
             {
-                SQLite::Statement query(*db,
+                const auto connection = connections->Acquire();
+                SQLite::Statement query(*connection,
                                         "SELECT identifier, latitude, longitude, "
                                         "(6371 * acos(cos(radians(?)) * cos(radians(latitude)) * cos(radians(longitude) - radians(?)) + sin(radians(?)) * sin(radians(latitude)))) AS distance "
                                         "FROM waypoints "
@@ -471,7 +495,8 @@ namespace RouteParser
 
             try
             {
-                SQLite::Statement query(*db,
+                const auto connection = connections->Acquire();
+                SQLite::Statement query(*connection,
                                         "SELECT ident, type, frequency_khz, latitude_deg, longitude_deg "
                                         "FROM navaids WHERE ident = ?");
                 query.bind(1, identifier);
@@ -521,7 +546,8 @@ namespace RouteParser
 
             try
             {
-                SQLite::Statement query(*db,
+                const auto connection = connections->Acquire();
+                SQLite::Statement query(*connection,
                                         "SELECT ident, type, frequency_khz, latitude_deg, longitude_deg, "
                                         "(6371 * acos(cos(radians(?)) * cos(radians(latitude_deg)) * cos(radians(longitude_deg) - radians(?)) + sin(radians(?)) * sin(radians(latitude_deg)))) AS distance "
                                         "FROM navaids "
@@ -568,15 +594,23 @@ namespace RouteParser
     class WaypointNetwork
     {
     private:
-        std::vector<std::unique_ptr<WaypointProvider>> providers;
+        using ProviderList = std::vector<std::shared_ptr<WaypointProvider>>;
+
+        // Replaced as a whole when a provider is added, so lookups can run while
+        // providers are still being loaded
+        SharedSnapshot<const ProviderList> providers{std::make_shared<const ProviderList>()};
+        std::mutex providersMutex;
+        // Lookups and prefetches may run on several threads, hits only share it
+        mutable std::shared_mutex cacheMutex;
         std::unordered_multimap<std::string, Waypoint> cache;
         bool useCache;
-        bool initialized{false};
+        // Identifier lookups made, whether served by the cache or a provider
+        std::atomic<uint64_t> lookups = 0;
 
-        void sortProvidersByPriority()
+        static void sortProvidersByPriority(ProviderList &list)
         {
-            std::sort(providers.begin(), providers.end(),
-                [](const std::unique_ptr<WaypointProvider>& a, const std::unique_ptr<WaypointProvider>& b) {
+            std::stable_sort(list.begin(), list.end(),
+                [](const std::shared_ptr<WaypointProvider>& a, const std::shared_ptr<WaypointProvider>& b) {
                     return a->getPriority() < b->getPriority(); // Lower priority number = higher priority
                 });
         }
@@ -586,7 +620,7 @@ namespace RouteParser
 
         bool isInitialized() const
         {
-            return initialized && !providers.empty();
+            return !providers.load()->empty();
         }
 
         bool addProvider(std::unique_ptr<WaypointProvider> provider)
@@ -599,16 +633,20 @@ namespace RouteParser
 
             try
             {
+                // Initialized outside the lock, providers may be loaded concurrently
                 if (provider->initialize())
                 {
                     Log::info("Successfully initialized waypoint provider: {} (Priority: {})",
                         provider->getName(), provider->getPriority());
-                    providers.push_back(std::move(provider));
+
+                    std::lock_guard<std::mutex> lock(providersMutex);
+                    auto updated = std::make_shared<ProviderList>(*providers.load());
+                    updated->push_back(std::move(provider));
 
                     // Sort providers by priority after adding
-                    sortProvidersByPriority();
+                    sortProvidersByPriority(*updated);
 
-                    initialized = true;
+                    providers.store(std::move(updated));
                     return true;
                 }
                 else
@@ -628,14 +666,16 @@ namespace RouteParser
         void printProviderOrder() const
         {
             Log::info("Waypoint provider search order:");
-            for (size_t i = 0; i < providers.size(); ++i) {
+            const auto current = providers.load();
+            for (size_t i = 0; i < current->size(); ++i) {
                 Log::info("  {}. {} (Priority: {})", i + 1,
-                    providers[i]->getName(), providers[i]->getPriority());
+                    (*current)[i]->getName(), (*current)[i]->getPriority());
             }
         }
 
         void initialCache(std::unordered_multimap<std::string, Waypoint> initialCache)
         {
+            std::unique_lock<std::shared_mutex> lock(cacheMutex);
             try
             {
                 cache = std::move(initialCache);
@@ -650,6 +690,7 @@ namespace RouteParser
 
         std::vector<Waypoint> findWaypoint(const std::string &identifier)
         {
+            lookups.fetch_add(1, std::memory_order_relaxed);
             if (!isInitialized())
             {
                 Log::error("Attempted to find waypoint with no initialized providers");
@@ -667,6 +708,7 @@ namespace RouteParser
                 // Check cache first if enabled
                 if (useCache)
                 {
+                    std::shared_lock<std::shared_mutex> lock(cacheMutex);
                     auto range = cache.equal_range(identifier);
                     if (range.first != range.second)
                     {
@@ -681,7 +723,8 @@ namespace RouteParser
                 }
 
                 // Search providers in priority order (already sorted)
-                for (const auto &provider : providers)
+                const auto current = providers.load();
+                for (const auto &provider : *current)
                 {
                     if (!provider->isInitialized())
                     {
@@ -695,12 +738,17 @@ namespace RouteParser
                         Log::debug("Provider '{}' found {} waypoints for '{}'",
                             provider->getName(), providerResults.size(), identifier);
 
-                        // Cache results if caching is enabled
+                        // Cache results if caching is enabled, unless another
+                        // lookup of the same identifier got there first
                         if (useCache)
                         {
-                            for (const auto &waypoint : providerResults)
+                            std::unique_lock<std::shared_mutex> lock(cacheMutex);
+                            if (cache.find(identifier) == cache.end())
                             {
-                                cache.insert({identifier, waypoint});
+                                for (const auto &waypoint : providerResults)
+                                {
+                                    cache.insert({identifier, waypoint});
+                                }
                             }
                         }
                         return providerResults;
@@ -839,6 +887,7 @@ namespace RouteParser
         {
             try
             {
+                std::unique_lock<std::shared_mutex> lock(cacheMutex);
                 cache.clear();
                 Log::info("Cache cleared");
             }
@@ -852,7 +901,7 @@ namespace RouteParser
         std::vector<std::string> getProviderOrder() const
         {
             std::vector<std::string> order;
-            for (const auto& provider : providers) {
+            for (const auto& provider : *providers.load()) {
                 order.push_back(provider->getName());
             }
             return order;
@@ -861,7 +910,37 @@ namespace RouteParser
         // Get provider count
         size_t getProviderCount() const
         {
-            return providers.size();
+            return providers.load()->size();
+        }
+
+        // Identifiers of the cached waypoints, each once
+        std::vector<std::string> cachedKeys() const
+        {
+            std::shared_lock<std::shared_mutex> lock(cacheMutex);
+            std::vector<std::string> keys;
+            for (auto it = cache.begin(); it != cache.end(); it = cache.equal_range(it->first).second) {
+                keys.push_back(it->first);
+            }
+            return keys;
+        }
+
+        uint64_t lookupCount() const
+        {
+            return lookups.load(std::memory_order_relaxed);
+        }
+
+        // The lookup cache, then each provider in priority order
+        std::vector<MemoryUsageEntry> memoryUsage() const
+        {
+            std::vector<MemoryUsageEntry> usage;
+            {
+                std::shared_lock<std::shared_mutex> lock(cacheMutex);
+                usage.push_back({ "waypoint cache", cache.size(), MemoryEstimate::HeapBytes(cache) });
+            }
+            for (const auto& provider : *providers.load()) {
+                usage.push_back(provider->memoryUsage());
+            }
+            return usage;
         }
     };
 }
\ No newline at end of file
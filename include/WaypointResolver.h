@@ -0,0 +1,129 @@
+#pragma once
+#include "types/Waypoint.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <vector>
+
+namespace RouteParser {
+
+enum WaypointResolutionMode {
+    // Each identifier is the candidate closest to the previous waypoint
+    RESOLVE_GREEDY,
+    // Identifiers are picked together for the shortest route, see WaypointResolver
+    RESOLVE_ROUTE
+};
+
+/**
+ * @class WaypointResolver
+ * @brief Resolves ambiguous identifiers of a route as a whole.
+ *
+ * Every identifier may match several waypoints around the world. Instead of taking
+ * the candidate closest to the previous pick, which lets one bad early pick cascade
+ * down the route, this picks the sequence of candidates with the shortest total
+ * path from origin to destination (Viterbi, O(n * k^2)).
+ */
+class WaypointResolver {
+public:
+    // Above these bounds the route is left to the greedy search
+    static constexpr size_t MaxCandidatesPerToken = 32;
+    static constexpr size_t MaxTransitions = 100000;
+
+    /**
+     * @brief Picks one candidate per token.
+     * @param candidates The candidates of each identifier, in route order, none empty.
+     * @param origin The origin airport, if known.
+     * @param destination The destination airport, if known.
+     * @return The index of the picked candidate for each token, or an empty optional
+     * when the route exceeds the bounds.
+     */
+    static std::optional<std::vector<size_t>> Resolve(
+        const std::vector<std::vector<Waypoint>>& candidates,
+        const std::optional<Waypoint>& origin, const std::optional<Waypoint>& destination)
+    {
+        size_t transitions = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (candidates[i].empty() || candidates[i].size() > MaxCandidatesPerToken) {
+                return std::nullopt;
+            }
+            transitions += candidates[i].size() * (i > 0 ? candidates[i - 1].size() : 1);
+        }
+        if (transitions > MaxTransitions) {
+            return std::nullopt;
+        }
+        if (candidates.empty()) {
+            return std::vector<size_t> {};
+        }
+
+        std::vector<std::vector<UnitVector>> vectors(candidates.size());
+        for (size_t i = 0; i < candidates.size(); i++) {
+            vectors[i].reserve(candidates[i].size());
+            for (const auto& waypoint : candidates[i]) {
+                vectors[i].push_back(ToUnitVector(waypoint));
+            }
+        }
+
+        // cost[j]: shortest path ending on candidate j of the current token
+        std::vector<double> cost(vectors[0].size(), 0.0);
+        if (origin) {
+            const auto start = ToUnitVector(*origin);
+            for (size_t j = 0; j < cost.size(); j++) {
+                cost[j] = Angle(start, vectors[0][j]);
+            }
+        }
+
+        // back[i][j]: candidate of token i - 1 preceding candidate j of token i
+        std::vector<std::vector<size_t>> back(candidates.size());
+        for (size_t i = 1; i < vectors.size(); i++) {
+            std::vector<double> next(vectors[i].size(), Infinity);
+            back[i].assign(vectors[i].size(), 0);
+            for (size_t j = 0; j < vectors[i].size(); j++) {
+                for (size_t p = 0; p < vectors[i - 1].size(); p++) {
+                    const double total = cost[p] + Angle(vectors[i - 1][p], vectors[i][j]);
+                    if (total < next[j]) {
+                        next[j] = total;
+                        back[i][j] = p;
+                    }
+                }
+            }
+            cost = std::move(next);
+        }
+
+        if (destination) {
+            const auto end = ToUnitVector(*destination);
+            for (size_t j = 0; j < cost.size(); j++) {
+                cost[j] += Angle(vectors.back()[j], end);
+            }
+        }
+
+        std::vector<size_t> picks(candidates.size());
+        picks.back() = std::min_element(cost.begin(), cost.end()) - cost.begin();
+        for (size_t i = picks.size() - 1; i > 0; i--) {
+            picks[i - 1] = back[i][picks[i]];
+        }
+        return picks;
+    }
+
+private:
+    using UnitVector = std::array<double, 3>;
+    static constexpr double Infinity = std::numeric_limits<double>::infinity();
+
+    static UnitVector ToUnitVector(const Waypoint& waypoint)
+    {
+        const double lat = waypoint.getPosition().latitude().radians();
+        const double lon = waypoint.getPosition().longitude().radians();
+        return { std::cos(lat) * std::cos(lon), std::cos(lat) * std::sin(lon),
+            std::sin(lat) };
+    }
+
+    // Great circle angle between two points on the unit sphere
+    static double Angle(const UnitVector& a, const UnitVector& b)
+    {
+        const double dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        return std::acos(std::clamp(dot, -1.0, 1.0));
+    }
+};
+
+} // namespace RouteParser
@@ -0,0 +1,12 @@
+#pragma once
+#include <stdexcept>
+
+namespace RouteParser
+{
+    class RouteDecodeException : public std::runtime_error
+    {
+    public:
+        RouteDecodeException(const std::string &message)
+            : std::runtime_error(message) {}
+    };
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace RouteParser {
+
+enum class BootstrapMode {
+    // Networks loaded one after another on the calling thread
+    Sequential,
+    // Networks loaded concurrently, Bootstrap returns once all are loaded
+    Parallel,
+    // As Parallel, but Bootstrap returns, and the handler is ready, as soon as the
+    // airway network and waypoints are loaded. Airports and runways follow in the
+    // background, lookups of either find nothing meanwhile.
+    Lazy
+};
+
+struct BootstrapOptions {
+    BootstrapMode mode = BootstrapMode::Sequential;
+    // Loader threads, 0 for one per network
+    size_t threads = 0;
+    // Hot cache keys prefetched in the background once ready, and saved back when
+    // the handler is destroyed. Empty to disable.
+    std::string warmStartFile;
+    // Also save the hot keys this often, 0 to only save on destruction
+    std::chrono::seconds warmStartSaveInterval { 0 };
+};
+
+} // namespace RouteParser
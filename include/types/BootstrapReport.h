@@ -0,0 +1,52 @@
+#pragma once
+#include "BootstrapOptions.h"
+#include "MemoryUsage.h"
+#include <cstddef>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace RouteParser {
+
+NLOHMANN_JSON_SERIALIZE_ENUM(BootstrapMode,
+    {
+        { BootstrapMode::Sequential, "sequential" },
+        { BootstrapMode::Parallel, "parallel" },
+        { BootstrapMode::Lazy, "lazy" },
+    })
+
+struct LoaderReport {
+    std::string name;
+    // Wall time of the loader, 0 while it is still running
+    double milliseconds = 0;
+    // Rows of its source table, procedures for the procedure loader. Tables are
+    // counted after the handler is ready, 0 until then.
+    size_t rows = 0;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(LoaderReport, name, milliseconds, rows)
+};
+
+struct BootstrapReport {
+    BootstrapMode mode = BootstrapMode::Sequential;
+    // From the start of Bootstrap until the handler was ready
+    double readyMilliseconds = 0;
+    // From the start of Bootstrap until every loader finished, 0 until then
+    double totalMilliseconds = 0;
+    std::vector<LoaderReport> loaders;
+    // Memory held when the report was taken
+    std::vector<MemoryUsageEntry> memory;
+
+    size_t TotalBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& entry : memory) {
+            bytes += entry.bytes;
+        }
+        return bytes;
+    }
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(
+        BootstrapReport, mode, readyMilliseconds, totalMilliseconds, loaders, memory)
+};
+
+} // namespace RouteParser
@@ -0,0 +1,247 @@
+#pragma once
+#include "ParsedRoute.h"
+#include "absl/container/flat_hash_map.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace RouteParser {
+
+// Segment referring to its waypoints and airway by index
+struct CompactSegment {
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint32_t airway = 0;
+    int heading = 0;
+    int minimumLevel = -1;
+};
+
+/**
+ * @struct CompactParsedRoute
+ * @brief Parse result storing every distinct waypoint and airway name once.
+ *
+ * A ParsedRoute holds each waypoint once in its waypoints and twice more in its
+ * segments, and again for the explicit route. Here they all refer to a single
+ * waypoint pool, which makes results much cheaper to keep and copy, e.g. in caches
+ * and queues. The JSON is the same as the one of the ParsedRoute it was built from.
+ */
+struct CompactParsedRoute {
+    std::string rawRoute = "";
+    std::vector<RouteWaypoint> waypointPool = {};
+    std::vector<std::string> airwayNames = {};
+
+    std::vector<uint32_t> waypoints = {};
+    std::vector<CompactSegment> segments = {};
+    std::vector<uint32_t> explicitWaypoints = {};
+    std::vector<CompactSegment> explicitSegments = {};
+    ParsingErrorCollector errors = {};
+    int totalTokens = 0;
+
+    std::optional<std::string> departureRunway = std::nullopt;
+    std::optional<std::string> arrivalRunway = std::nullopt;
+    ProcedurePtr SID = nullptr;
+    ProcedurePtr STAR = nullptr;
+    std::optional<std::string> suggestedDepartureRunway = std::nullopt;
+    std::optional<std::string> suggestedArrivalRunway = std::nullopt;
+    ProcedurePtr suggestedSID = nullptr;
+    ProcedurePtr suggestedSTAR = nullptr;
+    std::optional<std::string> sidConnectionWaypoint = std::nullopt;
+    std::optional<std::string> starConnectionWaypoint = std::nullopt;
+
+    // Generates the explicit route of the parsed route if not done yet
+    static CompactParsedRoute FromParsedRoute(const ParsedRoute& parsedRoute)
+    {
+        CompactParsedRoute compact;
+        Builder builder { compact };
+
+        compact.rawRoute = parsedRoute.rawRoute;
+        compact.waypoints = builder.AddWaypoints(parsedRoute.waypoints);
+        compact.segments = builder.AddSegments(parsedRoute.segments);
+        compact.explicitWaypoints = builder.AddWaypoints(parsedRoute.GetExplicitWaypoints());
+        compact.explicitSegments = builder.AddSegments(parsedRoute.GetExplicitSegments());
+        compact.errors = parsedRoute.errors;
+        compact.totalTokens = parsedRoute.totalTokens;
+        compact.departureRunway = parsedRoute.departureRunway;
+        compact.arrivalRunway = parsedRoute.arrivalRunway;
+        compact.SID = parsedRoute.SID;
+        compact.STAR = parsedRoute.STAR;
+        compact.suggestedDepartureRunway = parsedRoute.suggestedDepartureRunway;
+        compact.suggestedArrivalRunway = parsedRoute.suggestedArrivalRunway;
+        compact.suggestedSID = parsedRoute.suggestedSID;
+        compact.suggestedSTAR = parsedRoute.suggestedSTAR;
+        compact.sidConnectionWaypoint = parsedRoute.GetSidConnectionWaypoint();
+        compact.starConnectionWaypoint = parsedRoute.GetStarConnectionWaypoint();
+        return compact;
+    }
+
+    ParsedRoute ToParsedRoute() const
+    {
+        ParsedRoute parsedRoute;
+        parsedRoute.rawRoute = rawRoute;
+        parsedRoute.waypoints = ExpandWaypoints(waypoints);
+        parsedRoute.segments = ExpandSegments(segments);
+        parsedRoute.errors = errors;
+        parsedRoute.totalTokens = totalTokens;
+        parsedRoute.departureRunway = departureRunway;
+        parsedRoute.arrivalRunway = arrivalRunway;
+        parsedRoute.SID = SID;
+        parsedRoute.STAR = STAR;
+        parsedRoute.suggestedDepartureRunway = suggestedDepartureRunway;
+        parsedRoute.suggestedArrivalRunway = suggestedArrivalRunway;
+        parsedRoute.suggestedSID = suggestedSID;
+        parsedRoute.suggestedSTAR = suggestedSTAR;
+        parsedRoute.SetExplicitRoute({ ExpandSegments(explicitSegments),
+            ExpandWaypoints(explicitWaypoints), sidConnectionWaypoint,
+            starConnectionWaypoint });
+        return parsedRoute;
+    }
+
+    const RouteWaypoint& GetWaypoint(uint32_t index) const { return waypointPool[index]; }
+    const std::string& GetAirway(const CompactSegment& segment) const
+    {
+        return airwayNames[segment.airway];
+    }
+
+    friend void to_json(nlohmann::json& j, const CompactParsedRoute& r)
+    {
+        j["rawRoute"] = r.rawRoute;
+        j["waypoints"] = r.WaypointsToJson(r.waypoints);
+        j["errors"] = r.errors;
+        j["segments"] = r.SegmentsToJson(r.segments);
+        j["totalTokens"] = r.totalTokens;
+        j["departureRunway"] = r.departureRunway;
+        j["arrivalRunway"] = r.arrivalRunway;
+        j["SID"] = r.SID;
+        j["STAR"] = r.STAR;
+        j["suggestedDepartureRunway"] = r.suggestedDepartureRunway;
+        j["suggestedArrivalRunway"] = r.suggestedArrivalRunway;
+        j["suggestedSID"] = r.suggestedSID;
+        j["suggestedSTAR"] = r.suggestedSTAR;
+        j["explicitSegments"] = r.SegmentsToJson(r.explicitSegments);
+        j["explicitWaypoints"] = r.WaypointsToJson(r.explicitWaypoints);
+        j["sidConnectionWaypoint"] = r.sidConnectionWaypoint;
+        j["starConnectionWaypoint"] = r.starConnectionWaypoint;
+    }
+
+    friend void from_json(const nlohmann::json& j, CompactParsedRoute& r)
+    {
+        r = FromParsedRoute(j.get<ParsedRoute>());
+    }
+
+private:
+    // Interns waypoints and airway names while building
+    struct Builder {
+        CompactParsedRoute& route;
+        // Pool indices by identifier, most identifiers have a single waypoint
+        absl::flat_hash_map<std::string, std::vector<uint32_t>> waypointsByIdentifier;
+        absl::flat_hash_map<std::string, uint32_t> airwayIndices;
+
+        uint32_t AddWaypoint(const RouteWaypoint& waypoint)
+        {
+            auto& candidates = waypointsByIdentifier[waypoint.getIdentifier()];
+            for (const auto index : candidates) {
+                if (SameWaypoint(route.waypointPool[index], waypoint)) {
+                    return index;
+                }
+            }
+            const auto index = static_cast<uint32_t>(route.waypointPool.size());
+            route.waypointPool.push_back(waypoint);
+            candidates.push_back(index);
+            return index;
+        }
+
+        std::vector<uint32_t> AddWaypoints(const std::vector<RouteWaypoint>& waypoints)
+        {
+            std::vector<uint32_t> indices;
+            indices.reserve(waypoints.size());
+            for (const auto& waypoint : waypoints) {
+                indices.push_back(AddWaypoint(waypoint));
+            }
+            return indices;
+        }
+
+        std::vector<CompactSegment> AddSegments(
+            const std::vector<ParsedRouteSegment>& segments)
+        {
+            std::vector<CompactSegment> compact;
+            compact.reserve(segments.size());
+            for (const auto& segment : segments) {
+                auto [it, inserted] = airwayIndices.try_emplace(segment.airway,
+                    static_cast<uint32_t>(route.airwayNames.size()));
+                if (inserted) {
+                    route.airwayNames.push_back(segment.airway);
+                }
+                compact.push_back({ AddWaypoint(segment.from), AddWaypoint(segment.to),
+                    it->second, segment.heading, segment.minimumLevel });
+            }
+            return compact;
+        }
+    };
+
+    // Equal in everything serialised
+    static bool SameWaypoint(const RouteWaypoint& a, const RouteWaypoint& b)
+    {
+        const auto& aPlanned = a.m_plannedPosition;
+        const auto& bPlanned = b.m_plannedPosition;
+        const bool samePlanned = aPlanned.has_value() == bPlanned.has_value()
+            && (!aPlanned
+                || (aPlanned->plannedAltitude == bPlanned->plannedAltitude
+                    && aPlanned->plannedSpeed == bPlanned->plannedSpeed
+                    && aPlanned->altitudeUnit == bPlanned->altitudeUnit
+                    && aPlanned->speedUnit == bPlanned->speedUnit));
+        return samePlanned && a.getType() == b.getType()
+            && a.GetFlightRule() == b.GetFlightRule()
+            && a.getFrequencyHz() == b.getFrequencyHz()
+            && a.getPosition().latitude().degrees() == b.getPosition().latitude().degrees()
+            && a.getPosition().longitude().degrees()
+            == b.getPosition().longitude().degrees()
+            && a.getName() == b.getName();
+    }
+
+    std::vector<RouteWaypoint> ExpandWaypoints(const std::vector<uint32_t>& indices) const
+    {
+        std::vector<RouteWaypoint> expanded;
+        expanded.reserve(indices.size());
+        for (const auto index : indices) {
+            expanded.push_back(waypointPool[index]);
+        }
+        return expanded;
+    }
+
+    std::vector<ParsedRouteSegment> ExpandSegments(
+        const std::vector<CompactSegment>& compact) const
+    {
+        std::vector<ParsedRouteSegment> expanded;
+        expanded.reserve(compact.size());
+        for (const auto& segment : compact) {
+            expanded.push_back({ waypointPool[segment.from], waypointPool[segment.to],
+                airwayNames[segment.airway], segment.heading, segment.minimumLevel });
+        }
+        return expanded;
+    }
+
+    nlohmann::json WaypointsToJson(const std::vector<uint32_t>& indices) const
+    {
+        auto j = nlohmann::json::array();
+        for (const auto index : indices) {
+            j.push_back(waypointPool[index]);
+        }
+        return j;
+    }
+
+    nlohmann::json SegmentsToJson(const std::vector<CompactSegment>& compact) const
+    {
+        auto j = nlohmann::json::array();
+        for (const auto& segment : compact) {
+            j.push_back({ { "from", waypointPool[segment.from] },
+                { "to", waypointPool[segment.to] },
+                { "airway", airwayNames[segment.airway] },
+                { "minimumLevel", segment.minimumLevel },
+                { "heading", segment.heading } });
+        }
+        return j;
+    }
+};
+
+} // namespace RouteParser
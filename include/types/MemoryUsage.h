@@ -0,0 +1,168 @@
+#pragma once
+#include "Airport.h"
+#include "ParsedRoute.h"
+#include "Procedure.h"
+#include "Runway.h"
+#include "RouteWaypoint.h"
+#include "Waypoint.h"
+#include "absl/container/flat_hash_map.h"
+#include <cstddef>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RouteParser {
+
+// Memory held by one network, cache or index
+struct MemoryUsageEntry {
+    std::string name;
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(MemoryUsageEntry, name, entries, bytes)
+};
+
+/**
+ * @brief Estimates of the heap memory owned by navdata structures, beyond their own
+ * sizeof. Containers count their allocated capacity, hash tables their buckets and
+ * nodes as libstdc++ and abseil lay them out, shared procedures are counted by
+ * their owner only. Allocator overhead is not included.
+ */
+namespace MemoryEstimate {
+    inline size_t HeapBytes(const std::string& value)
+    {
+        // Short strings live in the object itself
+        return value.capacity() > std::string().capacity() ? value.capacity() + 1 : 0;
+    }
+
+    inline size_t HeapBytes(const Waypoint& waypoint)
+    {
+        return HeapBytes(waypoint.getIdentifier()) + HeapBytes(waypoint.getName());
+    }
+
+    inline size_t HeapBytes(const Airport& airport)
+    {
+        return HeapBytes(airport.getIdent()) + HeapBytes(airport.getName())
+            + HeapBytes(airport.getIsoCountry()) + HeapBytes(airport.getIsoRegion());
+    }
+
+    inline size_t HeapBytes(const Runway& runway)
+    {
+        return HeapBytes(runway.getAirportRef()) + HeapBytes(runway.getAirportIdent())
+            + HeapBytes(runway.getSurface()) + HeapBytes(runway.getLeIdent())
+            + HeapBytes(runway.getHeIdent());
+    }
+
+    inline size_t HeapBytes(const RouteWaypoint& waypoint)
+    {
+        return HeapBytes(static_cast<const Waypoint&>(waypoint));
+    }
+
+    // Shared, counted by its owner
+    template <typename T> size_t HeapBytes(const std::shared_ptr<T>&) { return 0; }
+
+    // Stored inline
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    size_t HeapBytes(const T&)
+    {
+        return 0;
+    }
+
+    template <typename A, typename B> size_t HeapBytes(const std::pair<A, B>& pair);
+    template <typename T> size_t HeapBytes(const std::optional<T>& value);
+    template <typename T, typename Alloc> size_t HeapBytes(const std::vector<T, Alloc>& values);
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const std::unordered_map<K, V, H, E, Alloc>& map);
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const std::unordered_multimap<K, V, H, E, Alloc>& map);
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const absl::flat_hash_map<K, V, H, E, Alloc>& map);
+
+    template <typename A, typename B> size_t HeapBytes(const std::pair<A, B>& pair)
+    {
+        return HeapBytes(pair.first) + HeapBytes(pair.second);
+    }
+
+    template <typename T> size_t HeapBytes(const std::optional<T>& value)
+    {
+        return value ? HeapBytes(*value) : 0;
+    }
+
+    template <typename T, typename Alloc> size_t HeapBytes(const std::vector<T, Alloc>& values)
+    {
+        size_t bytes = values.capacity() * sizeof(T);
+        for (const auto& value : values) {
+            bytes += HeapBytes(value);
+        }
+        return bytes;
+    }
+
+    // Node holding the value, the next pointer and the cached hash
+    template <typename Map> size_t NodeMapBytes(const Map& map)
+    {
+        size_t bytes = map.bucket_count() * sizeof(void*)
+            + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+        for (const auto& [key, value] : map) {
+            bytes += HeapBytes(key) + HeapBytes(value);
+        }
+        return bytes;
+    }
+
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const std::unordered_map<K, V, H, E, Alloc>& map)
+    {
+        return NodeMapBytes(map);
+    }
+
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const std::unordered_multimap<K, V, H, E, Alloc>& map)
+    {
+        return NodeMapBytes(map);
+    }
+
+    // Slots and one control byte per slot
+    template <typename K, typename V, typename H, typename E, typename Alloc>
+    size_t HeapBytes(const absl::flat_hash_map<K, V, H, E, Alloc>& map)
+    {
+        size_t bytes = map.capacity() * (sizeof(std::pair<const K, V>) + 1);
+        for (const auto& [key, value] : map) {
+            bytes += HeapBytes(key) + HeapBytes(value);
+        }
+        return bytes;
+    }
+
+    // The procedure, its shared_ptr control block and what it holds
+    inline size_t OwnedBytes(const Procedure& procedure)
+    {
+        return sizeof(Procedure) + 2 * sizeof(void*) + HeapBytes(procedure.name)
+            + HeapBytes(procedure.runway) + HeapBytes(procedure.icao)
+            + HeapBytes(procedure.waypoints);
+    }
+
+    // Procedures are shared with the navdata, the explicit route is not counted
+    inline size_t HeapBytes(const ParsedRoute& route)
+    {
+        size_t bytes = HeapBytes(route.rawRoute) + HeapBytes(route.waypoints)
+            + route.errors.size() * sizeof(ParsingError) + HeapBytes(route.origin)
+            + HeapBytes(route.destination) + HeapBytes(route.departureRunway)
+            + HeapBytes(route.arrivalRunway) + HeapBytes(route.suggestedDepartureRunway)
+            + HeapBytes(route.suggestedArrivalRunway) + HeapBytes(route.originAirport)
+            + HeapBytes(route.destinationAirport) + HeapBytes(route.greedyPicks);
+        bytes += route.segments.capacity() * sizeof(ParsedRouteSegment);
+        for (const auto& segment : route.segments) {
+            bytes += HeapBytes(segment.from) + HeapBytes(segment.to) + HeapBytes(segment.airway);
+        }
+        for (const auto& error : route.errors) {
+            bytes += HeapBytes(error.token);
+        }
+        return bytes;
+    }
+} // namespace MemoryEstimate
+
+} // namespace RouteParser
@@ -0,0 +1,43 @@
+#pragma once
+
+namespace RouteParser {
+
+// Stages of a parse that can be turned off when their output is not needed
+struct ParseOptions {
+    // SID/STAR and runway suggestions from the active runways
+    bool suggestions = true;
+    // Explicit route with SIDs, STARs and airport connections, generated on first use
+    bool explicitRoute = true;
+    // Human readable error messages, error types and tokens are always set
+    bool errorMessages = true;
+    // Segment headings, left at 0 when off
+    bool headings = true;
+    // Planned speed and level after a waypoint, e.g. TESIG/N0450F350
+    bool plannedAltitudeAndSpeed = true;
+
+    bool operator==(const ParseOptions&) const = default;
+
+    // Everything
+    static ParseOptions Full() { return {}; }
+
+    // Errors only, e.g. for flight plan validation
+    static ParseOptions ValidationOnly()
+    {
+        ParseOptions options;
+        options.suggestions = false;
+        options.explicitRoute = false;
+        options.headings = false;
+        return options;
+    }
+
+    // Geometry only, e.g. for drawing the route
+    static ParseOptions DisplayOnly()
+    {
+        ParseOptions options;
+        options.errorMessages = false;
+        options.plannedAltitudeAndSpeed = false;
+        return options;
+    }
+};
+
+} // namespace RouteParser
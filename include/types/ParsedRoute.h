@@ -1,7 +1,14 @@
 #pragma once
+#include "ParseOptions.h"
 #include "ParsingError.h"
+#include "ParsingErrorCollector.h"
+#include "Polyline.h"
 #include "Procedure.h"
 #include "RouteWaypoint.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -17,11 +24,29 @@ struct ParsedRouteSegment {
         ParsedRouteSegment, from, to, airway, minimumLevel, heading);
 };
 
+// Complete route with all segments (SID + route + STAR)
+struct ExplicitRoute {
+    std::vector<ParsedRouteSegment> segments = {};
+    std::vector<RouteWaypoint> waypoints = {};
+
+    // Connection points
+    std::optional<std::string> sidConnectionWaypoint = std::nullopt;
+    std::optional<std::string> starConnectionWaypoint = std::nullopt;
+};
+
+struct ParsedRoute;
+
+/**
+ * @brief Generates the explicit route of a parse result, including SIDs, STARs and
+ * airport connections. Defined with the parser.
+ */
+ExplicitRoute GenerateExplicitRoute(const ParsedRoute& parsedRoute);
+
 struct ParsedRoute {
     // Basic route information
     std::string rawRoute = "";
     std::vector<RouteWaypoint> waypoints = {};
-    std::vector<ParsingError> errors = {};
+    ParsingErrorCollector errors = {};
     std::vector<ParsedRouteSegment> segments = {};
     int totalTokens = 0;
 
@@ -29,27 +54,195 @@ struct ParsedRoute {
     std::optional<std::string> departureRunway = std::nullopt;
     std::optional<std::string> arrivalRunway = std::nullopt;
 
-    // Actual procedures
-    std::optional<Procedure> SID = std::nullopt;
-    std::optional<Procedure> STAR = std::nullopt;
+    // Actual procedures, shared with the navdata
+    ProcedurePtr SID = nullptr;
+    ProcedurePtr STAR = nullptr;
 
     // Suggested procedures and runways
     std::optional<std::string> suggestedDepartureRunway = std::nullopt;
     std::optional<std::string> suggestedArrivalRunway = std::nullopt;
-    std::optional<Procedure> suggestedSID = std::nullopt;
-    std::optional<Procedure> suggestedSTAR = std::nullopt;
+    ProcedurePtr suggestedSID = nullptr;
+    ProcedurePtr suggestedSTAR = nullptr;
 
-    // Complete route with all segments (SID + route + STAR)
-    std::vector<ParsedRouteSegment> explicitSegments = {};
-    std::vector<RouteWaypoint> explicitWaypoints = {};
+    // Airports, options and navdata version the route was parsed with, not
+    // serialised
+    std::string origin = "";
+    std::string destination = "";
+    ParseOptions options = {};
+    uint64_t navdataVersion = 0;
+    // Looked up while parsing, so a later generation of the explicit route does not
+    // depend on the navdata loaded by then
+    std::optional<Waypoint> originAirport = std::nullopt;
+    std::optional<Waypoint> destinationAirport = std::nullopt;
+    // Waypoint each token was resolved to under RESOLVE_GREEDY, by token index. A
+    // pick only depends on the tokens up to it, a reparse reuses those ahead of the
+    // first amended token.
+    std::vector<std::optional<Waypoint>> greedyPicks = {};
 
-    // Connection points
-    std::optional<std::string> sidConnectionWaypoint = std::nullopt;
-    std::optional<std::string> starConnectionWaypoint = std::nullopt;
+    // The explicit route is generated on first use, from the result as it is then.
+    // A copy takes it over only if already generated.
+    const ExplicitRoute& GetExplicitRoute() const
+    {
+        return explicitRoute.Get([this]() { return GenerateExplicitRoute(*this); });
+    }
+
+    const std::vector<ParsedRouteSegment>& GetExplicitSegments() const
+    {
+        return GetExplicitRoute().segments;
+    }
+
+    const std::vector<RouteWaypoint>& GetExplicitWaypoints() const
+    {
+        return GetExplicitRoute().waypoints;
+    }
+
+    const std::optional<std::string>& GetSidConnectionWaypoint() const
+    {
+        return GetExplicitRoute().sidConnectionWaypoint;
+    }
+
+    const std::optional<std::string>& GetStarConnectionWaypoint() const
+    {
+        return GetExplicitRoute().starConnectionWaypoint;
+    }
+
+    /**
+     * @brief Geometry of the explicit route as an encoded polyline, for map display.
+     * @param precision Decimals kept of each coordinate, 5 as Google's own format.
+     * @throws std::invalid_argument when precision is outside [0, Polyline::MaxPrecision].
+     */
+    std::string GetExplicitPolyline(int precision = 5) const
+    {
+        const auto& waypoints = GetExplicitWaypoints();
+        std::string encoded;
+        // Two coordinates of mostly 3 or 4 chunks each
+        encoded.reserve(waypoints.size() * 8);
+        Polyline polyline(encoded, precision);
+        for (const auto& waypoint : waypoints) {
+            polyline.Add(waypoint.getPosition());
+        }
+        return encoded;
+    }
+
+    // Replaces the explicit route instead of generating it
+    void SetExplicitRoute(ExplicitRoute route) { explicitRoute.Set(std::move(route)); }
+
+    friend void to_json(nlohmann::json& j, const ParsedRoute& r)
+    {
+        j["rawRoute"] = r.rawRoute;
+        j["waypoints"] = r.waypoints;
+        j["errors"] = r.errors;
+        j["segments"] = r.segments;
+        j["totalTokens"] = r.totalTokens;
+        j["departureRunway"] = r.departureRunway;
+        j["arrivalRunway"] = r.arrivalRunway;
+        j["SID"] = r.SID;
+        j["STAR"] = r.STAR;
+        j["suggestedDepartureRunway"] = r.suggestedDepartureRunway;
+        j["suggestedArrivalRunway"] = r.suggestedArrivalRunway;
+        j["suggestedSID"] = r.suggestedSID;
+        j["suggestedSTAR"] = r.suggestedSTAR;
+        j["explicitSegments"] = r.GetExplicitSegments();
+        j["explicitWaypoints"] = r.GetExplicitWaypoints();
+        j["sidConnectionWaypoint"] = r.GetSidConnectionWaypoint();
+        j["starConnectionWaypoint"] = r.GetStarConnectionWaypoint();
+    }
+
+    friend void from_json(const nlohmann::json& j, ParsedRoute& r)
+    {
+        j.at("rawRoute").get_to(r.rawRoute);
+        j.at("waypoints").get_to(r.waypoints);
+        j.at("errors").get_to(r.errors);
+        j.at("segments").get_to(r.segments);
+        j.at("totalTokens").get_to(r.totalTokens);
+        j.at("departureRunway").get_to(r.departureRunway);
+        j.at("arrivalRunway").get_to(r.arrivalRunway);
+        j.at("SID").get_to(r.SID);
+        j.at("STAR").get_to(r.STAR);
+        j.at("suggestedDepartureRunway").get_to(r.suggestedDepartureRunway);
+        j.at("suggestedArrivalRunway").get_to(r.suggestedArrivalRunway);
+        j.at("suggestedSID").get_to(r.suggestedSID);
+        j.at("suggestedSTAR").get_to(r.suggestedSTAR);
+
+        ExplicitRoute route;
+        j.at("explicitSegments").get_to(route.segments);
+        j.at("explicitWaypoints").get_to(route.waypoints);
+        j.at("sidConnectionWaypoint").get_to(route.sidConnectionWaypoint);
+        j.at("starConnectionWaypoint").get_to(route.starConnectionWaypoint);
+        r.SetExplicitRoute(std::move(route));
+    }
+
+private:
+    // Generated once, readers of one result may race to it
+    class LazyExplicitRoute {
+    public:
+        LazyExplicitRoute() = default;
+
+        LazyExplicitRoute(const LazyExplicitRoute& other)
+        {
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (other.generated.load(std::memory_order_relaxed)) {
+                value = other.value;
+                generated.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        LazyExplicitRoute& operator=(const LazyExplicitRoute& other)
+        {
+            if (this != &other) {
+                std::scoped_lock lock(mutex, other.mutex);
+                const bool otherGenerated = other.generated.load(std::memory_order_relaxed);
+                value = otherGenerated ? other.value : ExplicitRoute {};
+                generated.store(otherGenerated, std::memory_order_release);
+            }
+            return *this;
+        }
+
+        LazyExplicitRoute(LazyExplicitRoute&& other) noexcept
+        {
+            if (other.generated.load(std::memory_order_acquire)) {
+                value = std::move(other.value);
+                generated.store(true, std::memory_order_relaxed);
+                other.generated.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        LazyExplicitRoute& operator=(LazyExplicitRoute&& other) noexcept
+        {
+            if (this != &other) {
+                const bool otherGenerated = other.generated.load(std::memory_order_acquire);
+                value = otherGenerated ? std::move(other.value) : ExplicitRoute {};
+                generated.store(otherGenerated, std::memory_order_release);
+                other.generated.store(false, std::memory_order_relaxed);
+            }
+            return *this;
+        }
+
+        template <typename Generate> const ExplicitRoute& Get(Generate&& generate) const
+        {
+            if (!generated.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!generated.load(std::memory_order_relaxed)) {
+                    value = generate();
+                    generated.store(true, std::memory_order_release);
+                }
+            }
+            return value;
+        }
+
+        void Set(ExplicitRoute route)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            value = std::move(route);
+            generated.store(true, std::memory_order_release);
+        }
+
+    private:
+        mutable std::mutex mutex;
+        mutable std::atomic<bool> generated = false;
+        mutable ExplicitRoute value;
+    };
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(ParsedRoute, rawRoute, waypoints, errors, segments,
-        totalTokens, departureRunway, arrivalRunway, SID, STAR, suggestedDepartureRunway,
-        suggestedArrivalRunway, suggestedSID, suggestedSTAR, explicitSegments,
-        explicitWaypoints, sidConnectionWaypoint, starConnectionWaypoint)
+    LazyExplicitRoute explicitRoute;
 };
-} // namespace RouteParser
\ No newline at end of file
+} // namespace RouteParser
@@ -1,6 +1,11 @@
 #pragma once
+#include <fmt/args.h>
+#include <fmt/format.h>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
 
 namespace RouteParser {
 
@@ -26,14 +31,143 @@ enum ParsingErrorType {
     MULTIPLE_AIRWAYS_FOUND 
 };
 
+// Message of an error, rendered from the error arguments only when read
+enum ParsingErrorMessage {
+    MESSAGE_NONE, // No message, e.g. when turned off in the parse options
+    MESSAGE_TEXT, // Free text, in the first argument
+    MESSAGE_ROUTE_EMPTY,
+    MESSAGE_INVALID_PLANNED_POSITION,
+    MESSAGE_INVALID_LATLON,
+    MESSAGE_UNKNOWN_AIRWAY,
+    MESSAGE_UNKNOWN_AIRPORT,
+    MESSAGE_UNKNOWN_NAVAID,
+    MESSAGE_UNKNOWN_WAYPOINT,
+    MESSAGE_UNRECOGNIZED_TOKEN,
+    MESSAGE_DATABASE_NOT_INITIALIZED,
+    MESSAGE_DATABASE_ERROR,
+    MESSAGE_AIRWAY_NOT_FOUND,
+    MESSAGE_AIRWAY_END_FIX_NOT_FOUND,
+    MESSAGE_AIRWAY_DIRECTION,
+    MESSAGE_AIRWAY_WAYPOINT_NOT_FOUND,
+    MESSAGE_AIRWAY_REQUIRED_LEVEL,
+    MESSAGE_SUGGESTING_SID,
+    MESSAGE_SUGGESTING_STAR,
+    MESSAGE_EMPTY_TOKEN,
+    MESSAGE_PROCEDURE_RUNWAY_MISMATCH,
+    MESSAGE_PROCEDURE_AIRPORT_MISMATCH,
+    MESSAGE_RUNWAY_NOT_FOUND
+};
+
+// Format string of each message, arguments in order
+inline const char* GetMessageFormat(ParsingErrorMessage code)
+{
+    switch (code) {
+    case MESSAGE_NONE:
+        return "";
+    case MESSAGE_TEXT:
+        return "{}";
+    case MESSAGE_ROUTE_EMPTY:
+        return "Route is empty";
+    case MESSAGE_INVALID_PLANNED_POSITION:
+        return "Invalid planned TAS and Altitude, ignoring it.";
+    case MESSAGE_INVALID_LATLON:
+        return "Invalid lat/lon coordinate";
+    case MESSAGE_UNKNOWN_AIRWAY:
+        return "Unknown airway";
+    case MESSAGE_UNKNOWN_AIRPORT:
+        return "Unknown airport code";
+    case MESSAGE_UNKNOWN_NAVAID:
+        return "Unknown navigational aid";
+    case MESSAGE_UNKNOWN_WAYPOINT:
+        return "Unknown waypoint";
+    case MESSAGE_UNRECOGNIZED_TOKEN:
+        return "Unrecognized token format";
+    case MESSAGE_DATABASE_NOT_INITIALIZED:
+        return "Database not initialized";
+    case MESSAGE_DATABASE_ERROR:
+        return "Database error: {}";
+    case MESSAGE_AIRWAY_NOT_FOUND:
+        return "Airway not found: {}";
+    case MESSAGE_AIRWAY_END_FIX_NOT_FOUND:
+        return "End fix not found: {}";
+    case MESSAGE_AIRWAY_DIRECTION:
+        return "Cannot traverse airway {} from {} to {}";
+    case MESSAGE_AIRWAY_WAYPOINT_NOT_FOUND:
+        return "Waypoint not found: {}";
+    case MESSAGE_AIRWAY_REQUIRED_LEVEL:
+        return "Required FL{}";
+    case MESSAGE_SUGGESTING_SID:
+        return "Suggesting SID {} for runway {}";
+    case MESSAGE_SUGGESTING_STAR:
+        return "Suggesting STAR {} for runway {}";
+    case MESSAGE_EMPTY_TOKEN:
+        return "Empty token or ICAO";
+    case MESSAGE_PROCEDURE_RUNWAY_MISMATCH:
+        return "No matching runway {} found for procedure {} at {}, ignoring confirmed {}";
+    case MESSAGE_PROCEDURE_AIRPORT_MISMATCH:
+        return "Airport code {} doesn't match expected {}";
+    case MESSAGE_RUNWAY_NOT_FOUND:
+        return "Runway {} not found at airport {}";
+    }
+    return "";
+}
+
+// Arguments the format of a message takes
+inline size_t GetMessageArgumentCount(ParsingErrorMessage code)
+{
+    const std::string_view format = GetMessageFormat(code);
+    size_t count = 0;
+    for (auto at = format.find("{}"); at != std::string_view::npos;
+         at = format.find("{}", at + 2)) {
+        count++;
+    }
+    return count;
+}
+
+using ParsingErrorArgument = std::variant<std::string, int>;
+
 struct ParsingError {
     ParsingErrorType type;
-    std::string message;
+    ParsingErrorMessage messageCode;
+    std::vector<ParsingErrorArgument> arguments;
     int tokenIndex;
     std::string token;
     ParsingErrorLevel level;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(ParsingError, type, message, tokenIndex, token, level);
+    // Human readable message, formatted on each call
+    std::string GetMessage() const
+    {
+        fmt::dynamic_format_arg_store<fmt::format_context> store;
+        for (const auto& argument : arguments) {
+            std::visit([&store](const auto& value) { store.push_back(value); }, argument);
+        }
+        return fmt::vformat(GetMessageFormat(messageCode), store);
+    }
+
+    bool SameMessage(const ParsingError& other) const
+    {
+        return messageCode == other.messageCode && arguments == other.arguments;
+    }
+
+    friend void to_json(nlohmann::json& j, const ParsingError& error)
+    {
+        j["type"] = error.type;
+        j["message"] = error.GetMessage();
+        j["tokenIndex"] = error.tokenIndex;
+        j["token"] = error.token;
+        j["level"] = error.level;
+    }
+
+    // Read back as free text
+    friend void from_json(const nlohmann::json& j, ParsingError& error)
+    {
+        j.at("type").get_to(error.type);
+        error.messageCode = MESSAGE_TEXT;
+        error.arguments = { j.at("message").get<std::string>() };
+        j.at("tokenIndex").get_to(error.tokenIndex);
+        j.at("token").get_to(error.token);
+        j.at("level").get_to(error.level);
+    }
 };
 
 } // namespace RouteParser
\ No newline at end of file
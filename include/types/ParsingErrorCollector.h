@@ -0,0 +1,178 @@
+#pragma once
+#include "ParsingError.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @class ParsingErrorCollector
+ * @brief Errors of a parse in insertion order, with constant time duplicate checks.
+ *
+ * Errors are indexed by (type, tokenIndex, token), errors sharing those are chained
+ * and compared in full. Inserting and removing stay linear overall, even for routes
+ * with hundreds of bad tokens.
+ */
+class ParsingErrorCollector {
+public:
+    using value_type = ParsingError;
+    using const_iterator = std::vector<ParsingError>::const_iterator;
+
+    ParsingErrorCollector() = default;
+    ParsingErrorCollector(std::vector<ParsingError> errors)
+        : errors(std::move(errors))
+    {
+        Reindex();
+    }
+
+    // Adds the error, even if the same error is already there
+    void push_back(ParsingError error)
+    {
+        const auto position = static_cast<uint32_t>(errors.size());
+        errors.push_back(std::move(error));
+        Link(position);
+    }
+
+    /**
+     * @brief Adds the error unless an identical one is already there.
+     * @return Whether the error was added.
+     */
+    bool InsertIfNotDuplicate(const ParsingError& error)
+    {
+        auto it = heads.find(KeyView { error.type, error.tokenIndex, error.token });
+        if (it != heads.end()) {
+            for (auto position = it->second; position != End; position = next[position]) {
+                const auto& existing = errors[position];
+                if (existing.level == error.level && existing.SameMessage(error)) {
+                    return false;
+                }
+            }
+        }
+        push_back(error);
+        return true;
+    }
+
+    // Removes the matching errors in one pass, keeping the order of the others
+    template <typename Predicate> size_t RemoveIf(Predicate predicate)
+    {
+        const auto removed = std::erase_if(errors, predicate);
+        if (removed > 0) {
+            Reindex();
+        }
+        return removed;
+    }
+
+    size_t RemoveToken(const std::string& token)
+    {
+        return RemoveIf([&token](const ParsingError& error) { return error.token == token; });
+    }
+
+    // Messages are not part of the index, they can be dropped in place
+    void ClearMessages()
+    {
+        for (auto& error : errors) {
+            error.messageCode = MESSAGE_NONE;
+            error.arguments.clear();
+        }
+    }
+
+    void clear()
+    {
+        errors.clear();
+        next.clear();
+        heads.clear();
+    }
+
+    const std::vector<ParsingError>& Errors() const { return errors; }
+    const_iterator begin() const { return errors.begin(); }
+    const_iterator end() const { return errors.end(); }
+    size_t size() const { return errors.size(); }
+    bool empty() const { return errors.empty(); }
+    const ParsingError& operator[](size_t index) const { return errors[index]; }
+    const ParsingError& front() const { return errors.front(); }
+    const ParsingError& back() const { return errors.back(); }
+
+    friend void to_json(nlohmann::json& j, const ParsingErrorCollector& collector)
+    {
+        j = collector.errors;
+    }
+
+    friend void from_json(const nlohmann::json& j, ParsingErrorCollector& collector)
+    {
+        collector = ParsingErrorCollector(j.get<std::vector<ParsingError>>());
+    }
+
+private:
+    static constexpr uint32_t End = std::numeric_limits<uint32_t>::max();
+
+    struct Key {
+        ParsingErrorType type;
+        int tokenIndex;
+        std::string token;
+    };
+
+    // Lookups without copying the token
+    struct KeyView {
+        ParsingErrorType type;
+        int tokenIndex;
+        std::string_view token;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(const Key& key) const
+        {
+            return (*this)(KeyView { key.type, key.tokenIndex, key.token });
+        }
+        size_t operator()(const KeyView& key) const
+        {
+            return absl::HashOf(static_cast<int>(key.type), key.tokenIndex, key.token);
+        }
+    };
+
+    struct KeyEq {
+        using is_transparent = void;
+        static KeyView View(const Key& key) { return { key.type, key.tokenIndex, key.token }; }
+        static KeyView View(const KeyView& key) { return key; }
+        template <typename A, typename B> bool operator()(const A& a, const B& b) const
+        {
+            const auto left = View(a);
+            const auto right = View(b);
+            return left.type == right.type && left.tokenIndex == right.tokenIndex
+                && left.token == right.token;
+        }
+    };
+
+    void Link(uint32_t position)
+    {
+        const auto& error = errors[position];
+        auto [it, inserted] = heads.try_emplace(
+            Key { error.type, error.tokenIndex, error.token }, position);
+        next.push_back(inserted ? End : it->second);
+        it->second = position;
+    }
+
+    void Reindex()
+    {
+        next.clear();
+        heads.clear();
+        next.reserve(errors.size());
+        for (uint32_t position = 0; position < errors.size(); position++) {
+            Link(position);
+        }
+    }
+
+    std::vector<ParsingError> errors;
+    // Previous error with the same key, by position
+    std::vector<uint32_t> next;
+    // Last error of each key
+    absl::flat_hash_map<Key, uint32_t, KeyHash, KeyEq> heads;
+};
+
+} // namespace RouteParser
@@ -0,0 +1,124 @@
+#pragma once
+#include "erkir/geo/sphericalpoint.h"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace RouteParser {
+
+/**
+ * @brief Google encoded polyline, as read by most map libraries.
+ *
+ * Each coordinate is rounded to the given number of decimals, latitude first, and
+ * written as the difference to the previous one in printable 5 bit chunks.
+ * Precision 5 is Google's own, 6 is the one of OSRM and Valhalla.
+ */
+class Polyline {
+public:
+    // Throws std::invalid_argument when precision is outside [0, MaxPrecision]
+    explicit Polyline(std::string& out, int precision = 5)
+        : out(out)
+        , factor(Factor(precision))
+    {
+    }
+
+    void Add(const erkir::spherical::Point& position)
+    {
+        const auto latitude = Round(position.latitude().degrees());
+        const auto longitude = Round(position.longitude().degrees());
+        Write(latitude - previousLatitude);
+        Write(longitude - previousLongitude);
+        previousLatitude = latitude;
+        previousLongitude = longitude;
+    }
+
+    // Decimals beyond which the coordinates no longer fit the 64 bit deltas
+    static constexpr int MaxPrecision = 10;
+
+    // Throws std::invalid_argument on a truncated or malformed polyline, or a precision
+    // outside [0, MaxPrecision]
+    static std::vector<erkir::spherical::Point> Decode(
+        std::string_view encoded, int precision = 5)
+    {
+        const double factor = Factor(precision);
+        std::vector<erkir::spherical::Point> points;
+        size_t position = 0;
+        int64_t latitude = 0;
+        int64_t longitude = 0;
+        while (position < encoded.size()) {
+            latitude = Coordinate(latitude, Read(encoded, position), 90 * factor);
+            longitude = Coordinate(longitude, Read(encoded, position), 180 * factor);
+            points.emplace_back(latitude / factor, longitude / factor);
+        }
+        return points;
+    }
+
+private:
+    static double Factor(int precision)
+    {
+        if (precision < 0 || precision > MaxPrecision) {
+            throw std::invalid_argument("Polyline precision out of range");
+        }
+        return std::pow(10.0, precision);
+    }
+
+    // Previous coordinate moved by a delta, the previous one being within the limit
+    static int64_t Coordinate(int64_t previous, int64_t delta, double limit)
+    {
+        const auto bound = static_cast<int64_t>(limit);
+        if (delta < -2 * bound || delta > 2 * bound || previous + delta < -bound
+            || previous + delta > bound) {
+            throw std::invalid_argument("Polyline coordinate out of range");
+        }
+        return previous + delta;
+    }
+
+    // Rounds half up, as the JavaScript reference implementation
+    int64_t Round(double degrees) const
+    {
+        return static_cast<int64_t>(std::floor(degrees * factor + 0.5));
+    }
+
+    void Write(int64_t delta)
+    {
+        auto value = static_cast<uint64_t>(delta) << 1;
+        if (delta < 0) {
+            value = ~value;
+        }
+        while (value >= 0x20) {
+            out.push_back(static_cast<char>((0x20 | (value & 0x1F)) + 63));
+            value >>= 5;
+        }
+        out.push_back(static_cast<char>(value + 63));
+    }
+
+    static int64_t Read(std::string_view encoded, size_t& position)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 5) {
+            if (position >= encoded.size()) {
+                throw std::invalid_argument("Truncated polyline");
+            }
+            const int chunk = encoded[position++] - 63;
+            if (chunk < 0 || chunk > 0x3F) {
+                throw std::invalid_argument("Invalid polyline character");
+            }
+            value |= static_cast<uint64_t>(chunk & 0x1F) << shift;
+            if (!(chunk & 0x20)) {
+                return value & 1 ? ~static_cast<int64_t>(value >> 1)
+                                 : static_cast<int64_t>(value >> 1);
+            }
+        }
+        throw std::invalid_argument("Invalid polyline value");
+    }
+
+    std::string& out;
+    double factor;
+    int64_t previousLatitude = 0;
+    int64_t previousLongitude = 0;
+};
+
+} // namespace RouteParser
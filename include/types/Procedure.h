@@ -1,5 +1,6 @@
 #pragma once
 #include "Waypoint.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -16,4 +17,31 @@ namespace RouteParser {
 
         NLOHMANN_DEFINE_TYPE_INTRUSIVE(Procedure, name, runway, icao, type, waypoints)
     };
-}; // namespace RouteParser
\ No newline at end of file
+
+    // Procedures are loaded once and shared, never copied into parse results
+    using ProcedurePtr = std::shared_ptr<const Procedure>;
+}; // namespace RouteParser
+
+namespace nlohmann {
+// Serialised as the procedure itself, or null when there is none
+template <> struct adl_serializer<RouteParser::ProcedurePtr> {
+    static void to_json(json& j, const RouteParser::ProcedurePtr& procedure)
+    {
+        if (procedure) {
+            j = *procedure;
+        } else {
+            j = nullptr;
+        }
+    }
+
+    static void from_json(const json& j, RouteParser::ProcedurePtr& procedure)
+    {
+        if (j.is_null()) {
+            procedure = nullptr;
+        } else {
+            procedure = std::make_shared<const RouteParser::Procedure>(
+                j.get<RouteParser::Procedure>());
+        }
+    }
+};
+} // namespace nlohmann
\ No newline at end of file
@@ -38,8 +38,8 @@ public:
         this->frequencyHz = frequencyHz;
     }
     WaypointType getType() const { return type; };
-        std::string getName() const { return name; };
-    std::string getIdentifier() const { return identifier; };
+    const std::string& getName() const { return name; };
+    const std::string& getIdentifier() const { return identifier; };
     erkir::spherical::Point getPosition() const { return position; };
     int getFrequencyHz() const { return frequencyHz; };
 
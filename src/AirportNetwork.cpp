@@ -152,6 +152,7 @@ namespace RouteParser
 
         if (useCache_)
         {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
             auto it = cache_.find(ident);
             if (it != cache_.end())
             {
@@ -187,6 +188,7 @@ namespace RouteParser
 
                 if (useCache_)
                 {
+                    std::lock_guard<std::mutex> lock(cacheMutex_);
                     cache_[ident] = airport;
                 }
 
@@ -209,6 +211,7 @@ namespace RouteParser
     {
         try
         {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
             cache_.clear();
         }
         catch (const std::exception &e)
@@ -217,4 +220,22 @@ namespace RouteParser
         }
     }
 
+    MemoryUsageEntry AirportNetwork::memoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        return {"airport cache", cache_.size(), MemoryEstimate::HeapBytes(cache_)};
+    }
+
+    std::vector<std::string> AirportNetwork::cachedKeys() const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        std::vector<std::string> keys;
+        keys.reserve(cache_.size());
+        for (const auto& [key, _] : cache_)
+        {
+            keys.push_back(key);
+        }
+        return keys;
+    }
+
 } // namespace RouteParser
\ No newline at end of file
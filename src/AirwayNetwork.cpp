@@ -8,7 +8,6 @@
 
 namespace RouteParser {
 AirwayNetwork::AirwayNetwork(const std::string& dbPath)
-    : db(":memory:", SQLite::OPEN_READWRITE)
 {
     try {
         // Check if file exists
@@ -20,7 +19,12 @@ AirwayNetwork::AirwayNetwork(const std::string& dbPath)
         f.close();
 
         // If file exists, open it
-        db = SQLite::Database(dbPath, SQLite::OPEN_READONLY);
+        auto db = std::make_unique<SQLite::Database>(dbPath, SQLite::OPEN_READONLY);
+        SQLite::Statement names(*db, "SELECT DISTINCT name FROM airways");
+        while (names.executeStep()) {
+            airwayNames.insert(names.getColumn(0).getText());
+        }
+        connections = std::make_unique<ConnectionPool>(dbPath, std::move(db));
         isInitialized = true;
     } catch (const SQLite::Exception& e) {
         std::cerr << "Failed to open database: " << e.what() << std::endl;
@@ -30,6 +34,24 @@ AirwayNetwork::AirwayNetwork(const std::string& dbPath)
 struct AirwayGraph {
     std::unordered_map<std::string, std::vector<std::string>> adjacencyList;
     std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>> levels;
+
+    const std::vector<std::string>& Next(const std::string& fix) const
+    {
+        static const std::vector<std::string> none;
+        auto it = adjacencyList.find(fix);
+        return it != adjacencyList.end() ? it->second : none;
+    }
+
+    // 0 when the fixes are not connected
+    uint32_t Level(const std::string& from, const std::string& to) const
+    {
+        auto it = levels.find(from);
+        if (it == levels.end()) {
+            return 0;
+        }
+        auto level = it->second.find(to);
+        return level != it->second.end() ? level->second : 0;
+    }
 };
 
 RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& startFix,
@@ -41,7 +63,7 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
 
     if (!isInitialized) {
         result.errors.push_back(
-            { INVALID_DATA, "Database not initialized", 0, "", PARSE_ERROR });
+            { INVALID_DATA, MESSAGE_DATABASE_NOT_INITIALIZED, {}, 0, "", PARSE_ERROR });
         return result;
     }
 
@@ -50,7 +72,7 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
         if (!airwayExists(airway)) {
             result.isValid = false;
             result.errors.push_back(
-                { UNKNOWN_AIRWAY, "Airway not found: " + airway, 0, "", PARSE_ERROR });
+                { UNKNOWN_AIRWAY, MESSAGE_AIRWAY_NOT_FOUND, { airway }, 0, "", PARSE_ERROR });
             return result;
         }
 
@@ -59,32 +81,12 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
         if (!endFixWaypoint) {
             result.isValid = false;
             result.errors.push_back(
-                { UNKNOWN_WAYPOINT, "End fix not found: " + endFix, 0, "", PARSE_ERROR });
+                { UNKNOWN_WAYPOINT, MESSAGE_AIRWAY_END_FIX_NOT_FOUND, { endFix }, 0, "",
+                    PARSE_ERROR });
             return result;
         }
 
-        // Build graph from database
-        AirwayGraph graph;
-        SQLite::Statement segStmt(db, R"(
-                SELECT 
-                    ds.from_identifier,
-                    ds.to_identifier,
-                    ds.minimum_level
-                FROM direct_segments ds
-                WHERE ds.airway_name = ? 
-                AND ds.can_traverse = 1
-                ORDER BY ds.rowid
-            )");
-        segStmt.bind(1, airway);
-
-        while (segStmt.executeStep()) {
-            std::string fromId = segStmt.getColumn(0).getText();
-            std::string toId = segStmt.getColumn(1).getText();
-            uint32_t minLevel = segStmt.getColumn(2).getUInt();
-
-            graph.adjacencyList[fromId].push_back(toId);
-            graph.levels[fromId][toId] = minLevel;
-        }
+        const auto graph = airwayGraph(airway);
 
         // DFS implementation
         std::function<bool(const std::string&, std::unordered_set<std::string>&,
@@ -102,7 +104,7 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
 
             visited.insert(current);
 
-            for (const auto& next : graph.adjacencyList[current]) {
+            for (const auto& next : graph->Next(current)) {
                 path.push_back(next);
                 if (dfs(next, visited, path)) {
                     return true;
@@ -119,10 +121,8 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
 
         if (!dfs(startFix.getIdentifier(), visited, pathIds)) {
             result.isValid = false;
-            result.errors.push_back({ INVALID_AIRWAY_DIRECTION,
-                "Cannot traverse airway " + airway + " from " + startFix.getIdentifier()
-                    + " to " + endFix,
-                0, "", PARSE_ERROR });
+            result.errors.push_back({ INVALID_AIRWAY_DIRECTION, MESSAGE_AIRWAY_DIRECTION,
+                { airway, startFix.getIdentifier(), endFix }, 0, "", PARSE_ERROR });
             return result;
         }
 
@@ -136,7 +136,7 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
             if (!waypoint) {
                 result.isValid = false;
                 result.errors.push_back({ UNKNOWN_WAYPOINT,
-                    "Waypoint not found: " + pathIds[i], 0, "", PARSE_ERROR });
+                    MESSAGE_AIRWAY_WAYPOINT_NOT_FOUND, { pathIds[i] }, 0, "", PARSE_ERROR });
                 return result;
             }
 
@@ -145,7 +145,7 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
 
             // Check levels between consecutive waypoints
             if (i > 0) {
-                uint32_t level = graph.levels[pathIds[i - 1]][pathIds[i]];
+                uint32_t level = graph->Level(pathIds[i - 1], pathIds[i]);
                 maxRequiredLevel = std::max(maxRequiredLevel, level);
             }
         }
@@ -154,7 +154,9 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
         if (maxRequiredLevel > static_cast<uint32_t>(flightLevel)) {
             result.isValid = false;
             result.errors.push_back({ INSUFFICIENT_FLIGHT_LEVEL,
-                "Required FL" + std::to_string(maxRequiredLevel), 0, "", PARSE_ERROR });
+                MESSAGE_AIRWAY_REQUIRED_LEVEL,
+                { ParsingErrorArgument(static_cast<int>(maxRequiredLevel)) }, 0, "",
+                PARSE_ERROR });
             return result;
         }
 
@@ -163,8 +165,8 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
             AirwaySegmentInfo segment;
             segment.from = finalPath[i];
             segment.to = finalPath[i + 1];
-            segment.minimum_level = graph.levels[finalPath[i].getIdentifier()]
-                                                [finalPath[i + 1].getIdentifier()];
+            segment.minimum_level
+                = graph->Level(finalPath[i].getIdentifier(), finalPath[i + 1].getIdentifier());
             segment.canTraverse = true;
             result.segments.push_back(segment);
         }
@@ -172,8 +174,8 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
         result.path = finalPath;
     } catch (const SQLite::Exception& e) {
         result.isValid = false;
-        result.errors.push_back({ INVALID_DATA,
-            "Database error: " + std::string(e.what()), 0, "", PARSE_ERROR });
+        result.errors.push_back({ INVALID_DATA, MESSAGE_DATABASE_ERROR,
+            { std::string(e.what()) }, 0, "", PARSE_ERROR });
     }
 
     return result;
@@ -181,21 +183,75 @@ RouteValidationResult AirwayNetwork::validateAirwayTraversal(const Waypoint& sta
 
 bool AirwayNetwork::airwayExists(const std::string& airwayName)
 {
-    if (!isInitialized) {
-        return false;
-    }
-    try {
-        SQLite::Statement stmt(db, "SELECT COUNT(*) FROM airways WHERE name = ?");
-        stmt.bind(1, airwayName);
+    return isInitialized && airwayNames.contains(airwayName);
+}
 
-        if (stmt.executeStep()) {
-            int count = stmt.getColumn(0).getInt();
-            return count > 0;
+std::shared_ptr<const AirwayGraph> AirwayNetwork::airwayGraph(const std::string& airway)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(cacheMutex);
+        auto it = graphCache.find(airway);
+        if (it != graphCache.end()) {
+            return it->second;
         }
+    }
+
+    // Build graph from database
+    auto graph = std::make_shared<AirwayGraph>();
+    const auto connection = connections->Acquire();
+    SQLite::Statement segStmt(*connection, R"(
+            SELECT 
+                ds.from_identifier,
+                ds.to_identifier,
+                ds.minimum_level
+            FROM direct_segments ds
+            WHERE ds.airway_name = ? 
+            AND ds.can_traverse = 1
+            ORDER BY ds.rowid
+        )");
+    segStmt.bind(1, airway);
+
+    while (segStmt.executeStep()) {
+        std::string fromId = segStmt.getColumn(0).getText();
+        std::string toId = segStmt.getColumn(1).getText();
+        uint32_t minLevel = segStmt.getColumn(2).getUInt();
+
+        graph->adjacencyList[fromId].push_back(toId);
+        graph->levels[fromId][toId] = minLevel;
+    }
+
+    // Another thread may have built it meanwhile, both are the same
+    std::unique_lock<std::shared_mutex> lock(cacheMutex);
+    return graphCache.try_emplace(airway, std::move(graph)).first->second;
+}
+
+void AirwayNetwork::prefetchAirway(const std::string& airwayName)
+{
+    if (!airwayExists(airwayName)) {
+        return;
+    }
+    try {
+        airwayGraph(airwayName);
     } catch (const SQLite::Exception& e) {
         std::cerr << "Database error: " << e.what() << std::endl;
     }
-    return false;
+}
+
+MemoryUsageEntry AirwayNetwork::memoryUsage() const
+{
+    size_t bytes = airwayNames.bucket_count() * sizeof(void*);
+    for (const auto& name : airwayNames) {
+        bytes += sizeof(std::string) + sizeof(void*) + MemoryEstimate::HeapBytes(name);
+    }
+    std::shared_lock<std::shared_mutex> lock(cacheMutex);
+    bytes += graphCache.bucket_count() * sizeof(void*);
+    for (const auto& [airway, graph] : graphCache) {
+        bytes += sizeof(std::pair<const std::string, std::shared_ptr<const AirwayGraph>>)
+            + 2 * sizeof(void*) + MemoryEstimate::HeapBytes(airway) + sizeof(AirwayGraph)
+            + 2 * sizeof(void*) + MemoryEstimate::HeapBytes(graph->adjacencyList)
+            + MemoryEstimate::HeapBytes(graph->levels);
+    }
+    return { "airway cache", airwayNames.size() + graphCache.size(), bytes };
 }
 
 }
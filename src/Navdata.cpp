@@ -1,22 +1,33 @@
 #include "Navdata.h"
+#include "NavdataImage.h"
 #include <map>
 #include <memory>
 #include <mio/mmap.hpp>
+#include <sqlite3.h>
 #include <string>
 
 using namespace RouteParser;
 
-NavdataObject::NavdataObject() { waypointNetwork = std::make_shared<WaypointNetwork>(); }
+// Handlers share the navdata, a new one keeps the network already loaded
+NavdataObject::NavdataObject() { EnsureWaypointNetwork(); }
 
-void NavdataObject::LoadAirwayNetwork(std::string airwaysFilePath)
+std::shared_ptr<WaypointNetwork> NavdataObject::EnsureWaypointNetwork()
 {
-    if (!waypointNetwork)
-    {
-        waypointNetwork = std::make_shared<WaypointNetwork>();
+    std::lock_guard<std::mutex> lock(waypointNetworkMutex);
+    auto network = waypointNetwork.load();
+    if (!network) {
+        network = std::make_shared<WaypointNetwork>();
+        waypointNetwork.store(network);
     }
-    waypointNetwork->addProvider(
+    return network;
+}
+
+void NavdataObject::LoadAirwayNetwork(std::string airwaysFilePath)
+{
+    EnsureWaypointNetwork()->addProvider(
         std::make_unique<AirwayWaypointProvider>(airwaysFilePath, "Airways DB"));
-    airwayNetwork = std::make_shared<AirwayNetwork>(airwaysFilePath);
+    airwayNetwork.store(std::make_shared<AirwayNetwork>(airwaysFilePath));
+    dataVersion++;
 }
 
 void NavdataObject::LoadWaypoints(std::string waypointsFilePath)
@@ -28,47 +39,62 @@ void NavdataObject::LoadWaypoints(std::string waypointsFilePath)
         return;
     }
 
-    if (!waypointNetwork)
-    {
-        waypointNetwork = std::make_shared<WaypointNetwork>();
-    }
-
-    waypointNetwork->addProvider(
+    EnsureWaypointNetwork()->addProvider(
         std::make_unique<NavdataWaypointProvider>(waypointsFilePath, "Waypoints DB"));
+    dataVersion++;
 }
 
 void NavdataObject::LoadAirports(std::string airportsFilePath)
 {
 
-    airportNetwork = std::make_shared<AirportNetwork>(airportsFilePath);
+    airportNetwork.store(std::make_shared<AirportNetwork>(airportsFilePath));
+    dataVersion++;
 }
 
 void NavdataObject::LoadRunways(std::string runwaysFilePath)
 {
 
-    runwayNetwork = std::make_shared<RunwayNetwork>(runwaysFilePath);
+    runwayNetwork.store(std::make_shared<RunwayNetwork>(runwaysFilePath));
+    dataVersion++;
 }
 
 void NavdataObject::LoadNseWaypoints(
     const std::vector<Waypoint>& waypoints, const std::string& providerName)
 {
-    if (!waypointNetwork) {
-        waypointNetwork = std::make_shared<WaypointNetwork>();
+    EnsureWaypointNetwork()->addProvider(
+        std::make_unique<NseWaypointProvider>(waypoints, providerName));
+    dataVersion++;
+}
+
+void NavdataObject::LoadWaypointImage(
+    std::string waypointsFilePath, std::string imagePath, bool airwaysDb)
+{
+    std::error_code error;
+    const bool stale = !std::filesystem::exists(imagePath, error)
+        || (std::filesystem::exists(waypointsFilePath, error)
+            && std::filesystem::last_write_time(waypointsFilePath, error)
+                > std::filesystem::last_write_time(imagePath, error));
+    if (stale && !NavdataImage::BuildFromDatabase(waypointsFilePath, imagePath, airwaysDb)) {
+        Log::error("Navdata image {} unavailable, unable to load it.", imagePath);
+        return;
     }
 
-    waypointNetwork->addProvider(
-        std::make_unique<NseWaypointProvider>(waypoints, providerName));
+    const auto priority = airwaysDb ? ProviderPriority::AIRWAY : ProviderPriority::NAVDATA;
+    EnsureWaypointNetwork()->addProvider(std::make_unique<MappedWaypointProvider>(
+        imagePath, airwaysDb ? "Airways image" : "Waypoints image", static_cast<int>(priority)));
+    dataVersion++;
 }
 
 std::optional<Waypoint> RouteParser::NavdataObject::FindWaypoint(std::string identifier)
 {
     // Try waypoint network first
-    auto waypoint = waypointNetwork->findFirstWaypoint(identifier);
+    auto waypoint = waypointNetwork.load()->findFirstWaypoint(identifier);
 
     // If not found and identifier is 4 characters, try as airport
-    if (!waypoint && identifier.length() == 4 && airportNetwork)
+    const auto airports = airportNetwork.load();
+    if (!waypoint && identifier.length() == 4 && airports)
     {
-        if (auto airport = airportNetwork->findAirport(identifier))
+        if (auto airport = airports->findAirport(identifier))
         {
             return airport->toWaypoint();
         }
@@ -77,16 +103,34 @@ std::optional<Waypoint> RouteParser::NavdataObject::FindWaypoint(std::string ide
     return waypoint;
 }
 
+std::vector<Waypoint> NavdataObject::FindWaypointCandidates(const std::string& identifier)
+{
+    auto waypoints = waypointNetwork.load()->findWaypoint(identifier);
+
+    // If not found and identifier is 4 characters, try as airport
+    const auto airports = airportNetwork.load();
+    if (waypoints.empty() && identifier.length() == 4 && airports)
+    {
+        if (auto airport = airports->findAirport(identifier))
+        {
+            waypoints.push_back(airport->toWaypoint());
+        }
+    }
+
+    return waypoints;
+}
+
 std::optional<Waypoint> NavdataObject::FindClosestWaypoint(
     std::string identifier, erkir::spherical::Point referencePoint)
 {
     // Try waypoint network first
-    auto waypoint = waypointNetwork->findClosestWaypoint(identifier, referencePoint);
+    auto waypoint = waypointNetwork.load()->findClosestWaypoint(identifier, referencePoint);
 
     // If not found and identifier is 4 characters, try as airport
-    if (!waypoint && identifier.length() == 4 && airportNetwork)
+    const auto airports = airportNetwork.load();
+    if (!waypoint && identifier.length() == 4 && airports)
     {
-        if (auto airport = airportNetwork->findAirport(identifier))
+        if (auto airport = airports->findAirport(identifier))
         {
             return airport->toWaypoint();
         }
@@ -99,12 +143,13 @@ std::optional<Waypoint> RouteParser::NavdataObject::FindClosestWaypointTo(
     std::string nextWaypoint, std::optional<Waypoint> reference)
 {
     // Try waypoint network first
-    auto waypoint = waypointNetwork->findClosestWaypointTo(nextWaypoint, reference);
+    auto waypoint = waypointNetwork.load()->findClosestWaypointTo(nextWaypoint, reference);
 
     // If not found and identifier is 4 characters, try as airport
-    if (!waypoint && nextWaypoint.length() == 4 && airportNetwork)
+    const auto airports = airportNetwork.load();
+    if (!waypoint && nextWaypoint.length() == 4 && airports)
     {
-        if (auto airport = airportNetwork->findAirport(nextWaypoint))
+        if (auto airport = airports->findAirport(nextWaypoint))
         {
             return airport->toWaypoint();
         }
@@ -117,9 +162,10 @@ std::optional<Waypoint> NavdataObject::FindWaypointByType(
     std::string icao, WaypointType type)
 {
     // If specifically looking for AIRPORT type and identifier is 4 characters
-    if (type == WaypointType::AIRPORT && icao.length() == 4 && airportNetwork)
+    const auto airports = airportNetwork.load();
+    if (type == WaypointType::AIRPORT && icao.length() == 4 && airports)
     {
-        if (auto airport = airportNetwork->findAirport(icao))
+        if (auto airport = airports->findAirport(icao))
         {
             return airport->toWaypoint();
         }
@@ -136,3 +182,55 @@ std::optional<Waypoint> NavdataObject::FindWaypointByType(
     }
     return std::nullopt;
 }
+
+std::vector<MemoryUsageEntry> NavdataObject::MemoryUsage()
+{
+    std::vector<MemoryUsageEntry> usage;
+    if (const auto network = waypointNetwork.load()) {
+        usage = network->memoryUsage();
+    }
+    if (const auto airways = airwayNetwork.load()) {
+        usage.push_back(airways->memoryUsage());
+    }
+    if (const auto airports = airportNetwork.load()) {
+        usage.push_back(airports->memoryUsage());
+    }
+    if (const auto runways = runwayNetwork.load()) {
+        usage.push_back(runways->memoryUsage());
+    }
+
+    MemoryUsageEntry procedures { "procedures" };
+    MemoryUsageEntry indices { "procedure indices" };
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& [icao, chunk] : airportProcedures) {
+            procedures.entries += chunk->procedures.size();
+            procedures.bytes += sizeof(AirportProcedures) + 2 * sizeof(void*)
+                + chunk->procedures.capacity() * sizeof(ProcedurePtr);
+            for (const auto& procedure : chunk->procedures) {
+                procedures.bytes += MemoryEstimate::OwnedBytes(*procedure);
+            }
+            indices.entries += chunk->byName.size() + chunk->byRunway.size() + chunk->byFix.size();
+            indices.bytes += MemoryEstimate::HeapBytes(chunk->byName)
+                + MemoryEstimate::HeapBytes(chunk->byRunway)
+                + MemoryEstimate::HeapBytes(chunk->byFix);
+        }
+        procedures.bytes += MemoryEstimate::HeapBytes(airportProcedures)
+            + airportLoadOrder.size()
+                * (sizeof(std::pair<const uint64_t, std::string>) + 4 * sizeof(void*))
+            + MemoryEstimate::HeapBytes(airportLoadPositions);
+        indices.entries += procedureNameIndex.size();
+        indices.bytes += MemoryEstimate::HeapBytes(procedureNameIndex);
+    }
+    usage.push_back(procedures);
+    usage.push_back(indices);
+
+    {
+        std::lock_guard<std::mutex> lock(waypointsMutex);
+        usage.push_back({ "created waypoints", waypoints.size(), MemoryEstimate::HeapBytes(waypoints) });
+    }
+
+    // Page caches of every open database and the in-memory airway database
+    usage.push_back({ "sqlite", 0, static_cast<size_t>(sqlite3_memory_used()) });
+    return usage;
+}
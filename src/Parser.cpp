@@ -10,8 +10,14 @@
 #include "types/ParsingError.h"
 #include "types/RouteWaypoint.h"
 #include "types/Waypoint.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using namespace RouteParser;
@@ -19,6 +25,108 @@ using namespace RouteParser;
 const std::regex ParserHandler::sidStarPattern(
     "([A-Z]{2,5}\\d{1,2}[A-Z]?)(?:/([0-9]{2}[LRC]?))?");
 const std::regex ParserHandler::altitudeSpeedPattern("N\\d{4}F\\d{3}");
+const std::regex ParserHandler::procedureOrAirportPattern(
+    R"(\b(?:[A-Z]{1,5}\d[A-Z]?.*?|[A-Z]{4})\/\d{2}[LRC]?)");
+const std::regex ParserHandler::procedureNamePattern("[A-Z]{2,5}\\d{1,2}[A-Z]?");
+const std::regex ParserHandler::starCandidatePattern(
+    R"([A-Z]{1,5}\d[A-Z]?(?:.*)?(?:\/\d{2}[LRC]?)?)");
+const std::regex ParserHandler::runwayPattern("\\d{2}[LCR]?");
+
+namespace {
+// Tokens carrying nothing to parse
+bool IsSkippedToken(
+    std::string_view token, std::string_view origin, std::string_view destination)
+{
+    return token.empty() || token == origin || token == destination || token == " "
+        || token == "." || token == ".." || token == "DCT";
+}
+
+// Could be a fix, navaid, airport or airway
+bool IsIdentifierShaped(std::string_view token)
+{
+    return token.size() >= 2 && token.size() <= 7
+        && std::all_of(token.begin(), token.end(),
+            [](char c) { return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'); });
+}
+
+// Marks the prefetches of a parse as no longer needed when it returns
+struct PrefetchScope {
+    std::shared_ptr<std::atomic<bool>> finished;
+
+    ~PrefetchScope()
+    {
+        if (finished) {
+            *finished = true;
+        }
+    }
+};
+
+// PROCEDURE/RUNWAY or AIRPORT/RUNWAY
+bool IsPotentialProcedureToken(std::string_view token)
+{
+    return token.find('/') != std::string_view::npos
+        && std::regex_match(
+            token.begin(), token.end(), ParserHandler::procedureOrAirportPattern);
+}
+
+// The waypoint part of WAYPOINT/SPEEDLEVEL
+std::string IdentifierOf(std::string_view token)
+{
+    return std::string(token.substr(0, token.find('/')));
+}
+
+// Same pick as NavdataObject::FindClosestWaypointTo, from candidates already looked up
+std::optional<Waypoint> ClosestCandidate(
+    const std::vector<Waypoint>& candidates, const std::optional<Waypoint>& reference)
+{
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+    if (!reference) {
+        return candidates.front();
+    }
+    const auto position = reference->getPosition();
+    return *std::min_element(candidates.begin(), candidates.end(),
+        [&position](const Waypoint& a, const Waypoint& b) {
+            return position.distanceTo(a.getPosition())
+                < position.distanceTo(b.getPosition());
+        });
+}
+
+// Callers that only read the error types and tokens get no messages
+void DropErrorMessages(ParsedRoute& parsedRoute)
+{
+    if (!parsedRoute.options.errorMessages) {
+        parsedRoute.errors.ClearMessages();
+    }
+}
+
+// Rounded initial bearing between two waypoints, 0 when headings are turned off
+int SegmentHeading(
+    const ParsedRoute& parsedRoute, const Waypoint& from, const Waypoint& to)
+{
+    if (!parsedRoute.options.headings) {
+        return 0;
+    }
+    return static_cast<int>(std::round(from.getPosition().bearingTo(to.getPosition())));
+}
+
+// Greedy picks of the tokens ahead of the first amended one, made from the same
+// airports and the same tokens before them
+void ReuseGreedyPicks(RouteResolution& resolution,
+    std::span<const std::pmr::string> routeParts, std::string_view origin,
+    std::string_view destination, const ReparseSeed& seed)
+{
+    if (seed.origin != origin || seed.destination != destination) {
+        return;
+    }
+    const auto common = std::min(routeParts.size(), seed.tokens.size());
+    for (size_t i = 0; i < common && std::string_view(routeParts[i]) == seed.tokens[i];
+         i++) {
+        resolution.picks[i] = seed.picks[i];
+    }
+}
+} // namespace
 
 void ParserHandler::CleanupUnrecognizedPatterns(
     ParsedRoute& parsedRoute, const std::string& origin, const std::string& destination)
@@ -29,6 +137,7 @@ void ParserHandler::CleanupUnrecognizedPatterns(
 
     int tokensRemoved = 0;
     std::string cleanedRoute = parsedRoute.rawRoute;
+    std::unordered_set<std::string> removedTokens;
 
     // PART 1: Find and remove altitude/speed patterns before the first waypoint
     if (!parsedRoute.waypoints.empty()) {
@@ -56,14 +165,8 @@ void ParserHandler::CleanupUnrecognizedPatterns(
                     cleanedRoute.replace(pos, matchedStr.length(), "");
                     tokensRemoved++;
 
-                    // Remove any errors associated with this token
-                    for (size_t errIdx = 0; errIdx < parsedRoute.errors.size();) {
-                        if (parsedRoute.errors[errIdx].token == matchedStr) {
-                            parsedRoute.errors.erase(parsedRoute.errors.begin() + errIdx);
-                        } else {
-                            errIdx++;
-                        }
-                    }
+                    // Errors associated with this token are removed at the end
+                    removedTokens.insert(matchedStr);
                 }
 
                 // Update beforeFirstWaypoint for the next search
@@ -75,22 +178,35 @@ void ParserHandler::CleanupUnrecognizedPatterns(
     }
 
     // PART 2: Find and remove unrecognized SID/STAR patterns
-    std::regex sidStarPattern("\\b[A-Z]{2,5}\\d{1,2}[A-Z]?(?:/(?:[0-9]{2}[LRC]?))?\\b");
-    std::string routeCopy = cleanedRoute;
-    std::smatch matches;
-
-    // Collect all SID/STAR-like patterns
-    std::vector<std::string> sidStarTokens;
-    while (std::regex_search(routeCopy, matches, sidStarPattern)) {
-        sidStarTokens.push_back(matches.str());
-        routeCopy = matches.suffix();
+    static const std::regex sidStarPattern(
+        "\\b[A-Z]{2,5}\\d{1,2}[A-Z]?(?:/(?:[0-9]{2}[LRC]?))?\\b");
+
+    // Tokens of the route, removed ones are only marked
+    std::vector<std::string_view> routeTokens
+        = absl::StrSplit(cleanedRoute, ' ', absl::SkipEmpty());
+    std::vector<bool> removed(routeTokens.size(), false);
+    std::unordered_map<std::string_view, std::vector<size_t>> tokenPositions;
+    for (size_t i = 0; i < routeTokens.size(); i++) {
+        tokenPositions[routeTokens[i]].push_back(i);
     }
+    size_t first = 0;
+    size_t last = routeTokens.size();
 
     // Process each SID/STAR-like token
-    for (const auto& token : sidStarTokens) {
+    for (auto match = std::sregex_iterator(
+             cleanedRoute.begin(), cleanedRoute.end(), sidStarPattern);
+         match != std::sregex_iterator(); ++match) {
+        const std::string token = match->str();
+
         // Skip if it's the first or last token and matches a recognized procedure
-        if ((cleanedRoute.find(token) == 0 && parsedRoute.SID)
-            || (cleanedRoute.rfind(token) == cleanedRoute.length() - token.length()
+        while (first < last && removed[first]) {
+            first++;
+        }
+        while (last > first && removed[last - 1]) {
+            last--;
+        }
+        if ((first < last && routeTokens[first].starts_with(token) && parsedRoute.SID)
+            || (first < last && routeTokens[last - 1].ends_with(token)
                 && parsedRoute.STAR)) {
             continue;
         }
@@ -106,8 +222,8 @@ void ParserHandler::CleanupUnrecognizedPatterns(
         bool isProcedureInDatabase = false;
 
         for (const auto& procedure : matchingProcedures) {
-            if ((procedure.icao == origin && procedure.type == PROCEDURE_SID)
-                || (procedure.icao == destination && procedure.type == PROCEDURE_STAR)) {
+            if ((procedure->icao == origin && procedure->type == PROCEDURE_SID)
+                || (procedure->icao == destination && procedure->type == PROCEDURE_STAR)) {
                 isProcedureInDatabase = true;
                 break;
             }
@@ -115,50 +231,40 @@ void ParserHandler::CleanupUnrecognizedPatterns(
 
         // If not a recognized procedure, remove it
         if (!isProcedureInDatabase) {
-            size_t pos = 0;
-            while (
-                (pos = cleanedRoute.find(" " + token + " ", pos)) != std::string::npos) {
-                cleanedRoute.replace(pos, token.length() + 2, " ");
-                tokensRemoved++;
-            }
-
-            // Check beginning of string
-            if (cleanedRoute.find(token + " ") == 0) {
-                cleanedRoute.replace(0, token.length() + 1, "");
-                tokensRemoved++;
-            }
-
-            // Check end of string
-            if (cleanedRoute.length() >= token.length() + 1
-                && cleanedRoute.rfind(" " + token)
-                    == cleanedRoute.length() - token.length() - 1) {
-                cleanedRoute.replace(
-                    cleanedRoute.length() - token.length() - 1, token.length() + 1, "");
-                tokensRemoved++;
-            }
-
-            // Remove any errors associated with this token
-            for (size_t errIdx = 0; errIdx < parsedRoute.errors.size();) {
-                if (parsedRoute.errors[errIdx].token == token) {
-                    parsedRoute.errors.erase(parsedRoute.errors.begin() + errIdx);
-                } else {
-                    errIdx++;
+            if (auto positions = tokenPositions.find(token);
+                positions != tokenPositions.end()) {
+                for (const auto position : positions->second) {
+                    if (!removed[position]) {
+                        removed[position] = true;
+                        tokensRemoved++;
+                    }
                 }
             }
+
+            // Errors associated with this token are removed at the end
+            removedTokens.insert(token);
         }
     }
 
-    // Clean up multiple spaces and update the route
-    while (cleanedRoute.find("  ") != std::string::npos) {
-        cleanedRoute.replace(cleanedRoute.find("  "), 2, " ");
+    // Rebuilt with single spaces and no leading or trailing ones
+    std::string remainingRoute;
+    remainingRoute.reserve(cleanedRoute.size());
+    for (size_t i = 0; i < routeTokens.size(); i++) {
+        if (removed[i]) {
+            continue;
+        }
+        if (!remainingRoute.empty()) {
+            remainingRoute += ' ';
+        }
+        remainingRoute += routeTokens[i];
     }
+    cleanedRoute = std::move(remainingRoute);
 
-    // Trim leading/trailing spaces
-    if (!cleanedRoute.empty() && cleanedRoute.front() == ' ') {
-        cleanedRoute.erase(0, 1);
-    }
-    if (!cleanedRoute.empty() && cleanedRoute.back() == ' ') {
-        cleanedRoute.pop_back();
+    // In a single pass, the collector reindexes after each removal
+    if (!removedTokens.empty()) {
+        parsedRoute.errors.RemoveIf([&removedTokens](const ParsingError& error) {
+            return removedTokens.contains(error.token);
+        });
     }
 
     parsedRoute.rawRoute = cleanedRoute;
@@ -168,15 +274,15 @@ void ParserHandler::CleanupUnrecognizedPatterns(
 }
 
 bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
-    std::string token, std::string anchorIcao, bool strict,
+    std::string_view token, const std::string& anchorIcao, bool strict,
     std::string& tokenToRemove, FlightRule currentFlightRule)
 {
     // Initialize output parameter
     tokenToRemove = "";
 
     // Try to find the best match for this token
-    auto res = SidStarParser::FindProcedure(
-        token, anchorIcao, index == 0 ? PROCEDURE_SID : PROCEDURE_STAR, index);
+    auto res = SidStarParser::FindProcedure(std::string(token), anchorIcao,
+        index == 0 ? PROCEDURE_SID : PROCEDURE_STAR, index);
 
     // First, handle runway mismatch - this is a critical error that should mark the token for removal immediately
     for (const auto& error : res.errors) {
@@ -185,7 +291,7 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
             tokenToRemove = token;
 
             // Add error to parsed route
-            Utils::InsertParsingErrorIfNotDuplicate(parsedRoute.errors, error);
+            parsedRoute.errors.InsertIfNotDuplicate(error);
 
             // Return false to indicate we didn't successfully parse this token
             return false;
@@ -195,7 +301,7 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
         if (strict && error.type == UNKNOWN_PROCEDURE) {
             continue;  // Ignore unknown procedure errors in strict mode
         }
-        Utils::InsertParsingErrorIfNotDuplicate(parsedRoute.errors, error);
+        parsedRoute.errors.InsertIfNotDuplicate(error);
     }
 
     // In strict mode, require a procedure match
@@ -224,10 +330,10 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
     if (index == 0) {
         // SID case - determine quality of existing match
         int existingQuality = 0;
-        if (parsedRoute.SID.has_value() && parsedRoute.departureRunway.has_value()) {
+        if (parsedRoute.SID && parsedRoute.departureRunway.has_value()) {
             existingQuality = 3;  // Has procedure + runway
         }
-        else if (parsedRoute.SID.has_value()) {
+        else if (parsedRoute.SID) {
             existingQuality = 2;  // Has procedure but no runway
         }
         else if (parsedRoute.departureRunway.has_value()) {
@@ -250,7 +356,7 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
                         routePart, anchorIcao, PROCEDURE_SID, 0);
 
                     bool isSidToken = false;
-                    if (parsedRoute.SID.has_value() && oldMatch.extractedProcedure &&
+                    if (parsedRoute.SID && oldMatch.extractedProcedure &&
                         oldMatch.extractedProcedure->name == parsedRoute.SID->name) {
                         isSidToken = true;
                     }
@@ -273,10 +379,10 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
     else {
         // STAR case - similar logic to SID case
         int existingQuality = 0;
-        if (parsedRoute.STAR.has_value() && parsedRoute.arrivalRunway.has_value()) {
+        if (parsedRoute.STAR && parsedRoute.arrivalRunway.has_value()) {
             existingQuality = 3;
         }
-        else if (parsedRoute.STAR.has_value()) {
+        else if (parsedRoute.STAR) {
             existingQuality = 2;
         }
         else if (parsedRoute.arrivalRunway.has_value()) {
@@ -296,7 +402,7 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
                         routePart, anchorIcao, PROCEDURE_STAR, routeParts.size() - 1);
 
                     bool isStarToken = false;
-                    if (parsedRoute.STAR.has_value() && oldMatch.extractedProcedure &&
+                    if (parsedRoute.STAR && oldMatch.extractedProcedure &&
                         oldMatch.extractedProcedure->name == parsedRoute.STAR->name) {
                         isStarToken = true;
                     }
@@ -335,21 +441,36 @@ bool ParserHandler::ParseFirstAndLastPart(ParsedRoute& parsedRoute, int index,
     return true;
 }
 
-bool ParserHandler::ParseWaypoints(ParsedRoute& parsedRoute, int index, std::string token,
-    std::optional<Waypoint>& previousWaypoint, FlightRule currentFlightRule)
+std::optional<Waypoint> RouteResolution::Pick(size_t index, std::string_view identifier,
+    const std::optional<Waypoint>& previousWaypoint) const
+{
+    if (picks[index]) {
+        return picks[index];
+    }
+    if (candidates[index]) {
+        return ClosestCandidate(*candidates[index], previousWaypoint);
+    }
+    return NavdataObject::FindClosestWaypointTo(std::string(identifier), previousWaypoint);
+}
+
+bool ParserHandler::ParseWaypoints(ParsedRoute& parsedRoute, int index,
+    std::string_view routeToken, std::optional<Waypoint>& previousWaypoint,
+    FlightRule currentFlightRule, const RouteResolution* resolution)
 {
-    const std::vector<std::string> parts = absl::StrSplit(token, '/');
+    const std::vector<std::string> parts = absl::StrSplit(routeToken, '/');
     std::optional<RouteWaypoint::PlannedAltitudeAndSpeed> plannedAltAndSpd = std::nullopt;
-    token = parts[0];
+    const std::string& token = parts[0];
 
-    auto waypoint = NavdataObject::FindClosestWaypointTo(token, previousWaypoint);
+    auto waypoint = resolution
+        ? resolution->Pick(index, token, previousWaypoint)
+        : NavdataObject::FindClosestWaypointTo(token, previousWaypoint);
     if (waypoint) {
-        if (parts.size() > 1) {
+        if (parts.size() > 1 && parsedRoute.options.plannedAltitudeAndSpeed) {
             plannedAltAndSpd = this->ParsePlannedAltitudeAndSpeed(index, parts[1]);
             if (!plannedAltAndSpd) {
-                parsedRoute.errors.push_back(
-                    { INVALID_DATA, "Invalid planned TAS and Altitude, ignoring it.",
-                        index, token + '/' + parts[1], PARSE_ERROR });
+                parsedRoute.errors.push_back({ INVALID_DATA,
+                    MESSAGE_INVALID_PLANNED_POSITION, {}, index, token + '/' + parts[1],
+                    PARSE_ERROR });
             }
         }
 
@@ -360,9 +481,7 @@ bool ParserHandler::ParseWaypoints(ParsedRoute& parsedRoute, int index, std::str
             RouteWaypoint& prevWaypoint = parsedRoute.waypoints.back();
 
             // Calculate heading from previous to current waypoint
-            double bearing
-                = prevWaypoint.getPosition().bearingTo(newWaypoint.getPosition());
-            int heading = static_cast<int>(std::round(bearing));
+            int heading = SegmentHeading(parsedRoute, prevWaypoint, newWaypoint);
 
             ParsedRouteSegment segment{ prevWaypoint, newWaypoint, "DCT",
                 heading, // Set the heading
@@ -378,13 +497,13 @@ bool ParserHandler::ParseWaypoints(ParsedRoute& parsedRoute, int index, std::str
     return false;
 }
 std::optional<RouteWaypoint::PlannedAltitudeAndSpeed>
-ParserHandler::ParsePlannedAltitudeAndSpeed(int index, std::string rightToken)
+ParserHandler::ParsePlannedAltitudeAndSpeed(int index, std::string_view rightToken)
 {
     // Example is WAYPOINT/N0490F370 (knots) or WAYPOINT/M083F360 (mach) or
     // WAYPOINT/K0880F360 (kmh) For alt F370 is FL feet, S0150 is 1500 meters,
     // A055 is alt 5500, M0610 is alt 6100 meters For speed, K0880 is 880 km/h,
     // M083 is mach 0.83, S0150 is 150 knots
-    if (std::regex_match(rightToken, std::regex("\\d{2}[LCR]?"))) {
+    if (std::regex_match(rightToken.begin(), rightToken.end(), runwayPattern)) {
         return std::nullopt;
     }
 
@@ -443,26 +562,287 @@ ParserHandler::ParsePlannedAltitudeAndSpeed(int index, std::string rightToken)
     return std::nullopt;
 }
 
+RouteResolution ParserHandler::ResolveRouteWaypoints(WaypointResolutionMode mode,
+    std::span<const std::pmr::string> routeParts, const std::pmr::vector<bool>& airwayTokens,
+    const std::optional<Waypoint>& origin, const std::optional<Waypoint>& destination,
+    ParseArena& arena)
+{
+    RouteResolution resolution { ResolvedWaypoints(routeParts.size(), arena.get()),
+        WaypointCandidates(routeParts.size(), arena.get()) };
+    auto& resolved = resolution.picks;
+    if (mode != RESOLVE_ROUTE) {
+        return resolution;
+    }
+
+    std::pmr::vector<size_t> tokenIndices(arena.get());
+    bool ambiguous = false;
+    for (size_t i = 0; i < routeParts.size(); i++) {
+        const auto& token = routeParts[i];
+        if (IsSkippedToken(token, origin ? origin->getIdentifier() : "",
+                destination ? destination->getIdentifier() : "")
+            || airwayTokens[i] || IsPotentialProcedureToken(token)) {
+            continue;
+        }
+
+        // Kept for the main pass, which then needs no lookup of its own
+        auto& found = resolution.candidates[i];
+        found = NavdataObject::FindWaypointCandidates(IdentifierOf(token));
+        if (found->empty()) {
+            continue;
+        }
+        ambiguous = ambiguous || found->size() > 1;
+        tokenIndices.push_back(i);
+    }
+
+    // Unambiguous routes resolve the same either way
+    if (!ambiguous) {
+        return resolution;
+    }
+
+    std::vector<std::vector<Waypoint>> candidates;
+    candidates.reserve(tokenIndices.size());
+    for (const auto index : tokenIndices) {
+        candidates.push_back(*resolution.candidates[index]);
+    }
+
+    auto picks = WaypointResolver::Resolve(candidates, origin, destination);
+    if (!picks) {
+        Log::info("Route too ambiguous for route-level resolution, resolving "
+                  "waypoints one by one");
+        return resolution;
+    }
+
+    for (size_t k = 0; k < tokenIndices.size(); k++) {
+        resolved[tokenIndices[k]] = candidates[k][(*picks)[k]];
+    }
+    return resolution;
+}
+
+ReparseSeed ParserHandler::BuildReparseSeed(const ParsedRoute& previous)
+{
+    ReparseSeed seed;
+    const auto previousRoute = Utils::CleanupRawRoute(previous.rawRoute);
+    if (previousRoute.empty()) {
+        return seed;
+    }
+    const std::vector<std::string> previousParts = absl::StrSplit(previousRoute, ' ');
+
+    // Airway traversals that went through without errors
+    for (size_t i = 0; i < previous.segments.size();) {
+        const auto& airway = previous.segments[i].airway;
+        size_t end = i + 1;
+        while (end < previous.segments.size() && previous.segments[end].airway == airway
+            && airway != "DCT") {
+            end++;
+        }
+
+        // Back to back traversals of one airway cannot be told apart
+        const bool hadErrors = std::any_of(previous.errors.begin(), previous.errors.end(),
+            [&airway](const ParsingError& error) { return error.token == airway; });
+        const bool repeated
+            = std::count(previousParts.begin(), previousParts.end(), airway) > 1;
+        if (airway != "DCT" && !hadErrors && !repeated) {
+            const bool chained = i > 0 && previous.segments[i - 1].airway != "DCT";
+            seed.airways.push_back({ previous.segments[i].from, airway,
+                previous.segments[end - 1].to.getIdentifier(),
+                { previous.segments.begin() + i, previous.segments.begin() + end },
+                chained });
+        }
+        i = end;
+    }
+
+    if (previous.greedyPicks.size() == previousParts.size()) {
+        seed.tokens = previousParts;
+        seed.picks = previous.greedyPicks;
+        seed.origin = previous.origin;
+        seed.destination = previous.destination;
+    }
+    return seed;
+}
+
+ParseCacheKey ParserHandler::MakeCacheKey(const std::string& route,
+    const std::string& origin, const std::string& destination, FlightRule filedFlightRule,
+    const ParseOptions& options) const
+{
+    return { Utils::CleanupRawRoute(route), origin, destination, filedFlightRule, options,
+        waypointResolution, NavdataObject::GetNavdataVersion(),
+        airportConfigurator ? airportConfigurator->GetRunwayVersion() : 0 };
+}
+
+std::shared_ptr<const ParsedRoute> ParserHandler::FindCachedResult(
+    ParseResultCache& cache, const ParseCacheKey& key, const std::string& route) const
+{
+    auto cached = cache.Find(key);
+    if (!cached || cached->rawRoute == route) {
+        return cached;
+    }
+    // Same route written differently, only the raw string differs
+    auto patched = std::make_shared<ParsedRoute>(*cached);
+    patched->rawRoute = route;
+    return patched;
+}
+
+std::shared_ptr<const ParsedRoute> ParserHandler::ParseRawRouteShared(
+    const std::string& route, const std::string& origin, const std::string& destination,
+    FlightRule filedFlightRule, const ParseOptions& options)
+{
+    const auto cache = resultCache.load();
+    if (!cache) {
+        return std::make_shared<const ParsedRoute>(
+            ParseRawRoute(route, origin, destination, filedFlightRule, options));
+    }
+
+    const auto key = MakeCacheKey(route, origin, destination, filedFlightRule, options);
+    if (auto cached = FindCachedResult(*cache, key, route)) {
+        return cached;
+    }
+
+    // Parsed with the mode of the key, it may have changed since
+    auto result = std::make_shared<const ParsedRoute>(ParseRawRouteSeeded(
+        route, origin, destination, filedFlightRule, options, key.resolution, nullptr));
+    cache->Insert(key, result);
+    return result;
+}
+
+Task<ParsedRoute> ParserHandler::ParseRawRouteAsync(Executor& executor, std::string route,
+    std::string origin, std::string destination, FlightRule filedFlightRule,
+    ParseOptions options)
+{
+    const auto cache = resultCache.load();
+    if (!cache) {
+        co_await ScheduleOn(executor);
+        co_return ParseRawRoute(route, origin, destination, filedFlightRule, options);
+    }
+
+    const auto key = MakeCacheKey(route, origin, destination, filedFlightRule, options);
+    if (auto cached = FindCachedResult(*cache, key, route)) {
+        co_return *cached;
+    }
+
+    // Lookups may wait on SQLite. The parser resolves tokens one after the other
+    // through synchronous lookups, so the whole parse moves to the executor.
+    co_await ScheduleOn(executor);
+    auto result = std::make_shared<const ParsedRoute>(ParseRawRouteSeeded(
+        route, origin, destination, filedFlightRule, options, key.resolution, nullptr));
+    cache->Insert(key, result);
+    co_return *result;
+}
+
 ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
-    std::string destination, FlightRule filedFlightRule)
+    std::string destination, FlightRule filedFlightRule, const ParseOptions& options)
+{
+    return ParseRawRouteSeeded(route, origin, destination, filedFlightRule, options,
+        waypointResolution, nullptr);
+}
+
+ParsedRoute ParserHandler::ReparseRawRoute(const ParsedRoute& previous, std::string route,
+    std::string origin, std::string destination, FlightRule filedFlightRule,
+    const ParseOptions& options)
+{
+    // Anything reused from an older navdata could be stale
+    if (previous.navdataVersion != NavdataObject::GetNavdataVersion()) {
+        return ParseRawRoute(route, origin, destination, filedFlightRule, options);
+    }
+
+    const auto seed = BuildReparseSeed(previous);
+    return ParseRawRouteSeeded(route, origin, destination, filedFlightRule, options,
+        waypointResolution, &seed);
+}
+
+std::shared_ptr<std::atomic<bool>> ParserHandler::PrefetchLookups(
+    std::span<const std::pmr::string> routeParts, const std::string& origin,
+    const std::string& destination)
+{
+    const auto pool = prefetchPool.load();
+    const auto airwayNetwork = NavdataObject::GetAirwayNetwork();
+    if (!pool || !airwayNetwork) {
+        return nullptr;
+    }
+
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    std::vector<std::string> queued;
+    // From the last token back, the parse works its way from the first one
+    for (auto token = routeParts.rbegin(); token != routeParts.rend(); ++token) {
+        if (IsSkippedToken(*token, origin, destination)) {
+            continue;
+        }
+        auto identifier = IdentifierOf(*token);
+        if (!IsIdentifierShaped(identifier)
+            || std::find(queued.begin(), queued.end(), identifier) != queued.end()) {
+            continue;
+        }
+        queued.push_back(identifier);
+        pool->Post([identifier = std::move(identifier), airwayNetwork, finished]() {
+            if (*finished) {
+                return;
+            }
+            // Airway names are in memory, only the lookup the parse will make is run
+            if (airwayNetwork->airwayExists(identifier)) {
+                airwayNetwork->prefetchAirway(identifier);
+            } else {
+                NavdataObject::FindWaypointCandidates(identifier);
+            }
+        });
+    }
+    return finished;
+}
+
+ParsedRoute ParserHandler::ParseRawRouteSeeded(std::string route, std::string origin,
+    std::string destination, FlightRule filedFlightRule, const ParseOptions& options,
+    WaypointResolutionMode resolution, const ReparseSeed* seed)
 {
     auto parsedRoute = ParsedRoute();
     parsedRoute.rawRoute = route;
+    parsedRoute.origin = origin;
+    parsedRoute.destination = destination;
+    parsedRoute.options = options;
+    parsedRoute.navdataVersion = NavdataObject::GetNavdataVersion();
     route = Utils::CleanupRawRoute(route);
 
     if (route.empty()) {
         parsedRoute.errors.push_back(
-            { ROUTE_EMPTY, "Route is empty", 0, "", PARSE_ERROR });
+            { ROUTE_EMPTY, MESSAGE_ROUTE_EMPTY, {}, 0, "", PARSE_ERROR });
+        // Nothing to make explicit
+        parsedRoute.SetExplicitRoute({});
+        DropErrorMessages(parsedRoute);
         return parsedRoute;
     }
 
-    const std::vector<std::string> routeParts = absl::StrSplit(route, ' ');
+    // Scratch data of this parse, released at once when it returns
+    ParseArena arena;
+    RouteTokens routeParts(arena.get());
+    routeParts.reserve(std::count(route.begin(), route.end(), ' ') + 1);
+    for (const auto part : absl::StrSplit(route, ' ')) {
+        routeParts.emplace_back(part);
+    }
     parsedRoute.totalTokens = static_cast<int>(routeParts.size());
+    // Later tokens are looked up in the background while the first ones are parsed
+    const PrefetchScope prefetch { PrefetchLookups(routeParts, origin, destination) };
     auto previousWaypoint = NavdataObject::FindWaypointByType(origin, AIRPORT);
+    parsedRoute.originAirport = previousWaypoint;
+    parsedRoute.destinationAirport = NavdataObject::FindWaypointByType(destination, AIRPORT);
     FlightRule currentFlightRule = filedFlightRule;
 
+    // Airway lookups are shared by both passes and the waypoint resolution
+    std::pmr::vector<bool> airwayTokens(routeParts.size(), false, arena.get());
+    const auto airwayNetwork = NavdataObject::GetAirwayNetwork();
+    for (size_t i = 0; i < routeParts.size(); i++) {
+        if (!IsSkippedToken(routeParts[i], origin, destination)) {
+            airwayTokens[i] = airwayNetwork->airwayExists(std::string(routeParts[i]));
+        }
+    }
+
+    auto routeResolution = ResolveRouteWaypoints(resolution, routeParts, airwayTokens,
+        previousWaypoint, parsedRoute.destinationAirport, arena);
+    if (resolution == RESOLVE_GREEDY) {
+        parsedRoute.greedyPicks.resize(routeParts.size());
+        if (seed) {
+            ReuseGreedyPicks(routeResolution, routeParts, origin, destination, *seed);
+        }
+    }
+
     // Track tokens to remove (for overridden SID/STAR procedures)
-    std::vector<std::string> tokensToRemove;
+    std::pmr::vector<std::pmr::string> tokensToRemove(arena.get());
 
     // Track if we've found the first waypoint (to stop SID parsing)
     bool foundFirstWaypoint = false;
@@ -471,7 +851,7 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
 
     // First pass: Process SID tokens (at beginning), waypoints and airways
     for (auto i = 0; i < routeParts.size(); i++) {
-        const auto token = routeParts[i];
+        const std::string_view token = routeParts[i];
 
         // Skip empty/special tokens
         if (token.empty() || token == origin || token == destination || token == " "
@@ -503,31 +883,30 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
             std::string tokenToRemove;
             if (this->ParseFirstAndLastPart(parsedRoute, 0, token, origin, true, tokenToRemove, currentFlightRule)) {
                 if (!tokenToRemove.empty()) {
-                    tokensToRemove.push_back(tokenToRemove);
+                    tokensToRemove.emplace_back(tokenToRemove);
                 }
                 continue;
             }
             else if (!tokenToRemove.empty()) {
                 // Even if ParseFirstAndLastPart returned false, it might have marked a token for removal
-                tokensToRemove.push_back(tokenToRemove);
+                tokensToRemove.emplace_back(tokenToRemove);
                 continue;
             }
         }
 
         // Check if token is a known airway
-        bool isAirway = NavdataObject::GetAirwayNetwork()->airwayExists(token);
+        bool isAirway = airwayTokens[i];
 
         // Check if token looks like a STAR (contains at least one letter, one digit, and possibly a slash)
-        bool isPotentialStar = false;
-        if (token.find('/') != std::string::npos) {
-            // Check if this matches a PROCEDURE/RUNWAY or AIRPORT/RUNWAY pattern
-            std::regex procedureOrAirportPattern(R"(\b(?:[A-Z]{1,5}\d[A-Z]?.*?|[A-Z]{4})\/\d{2}[LRC]?)");
-            isPotentialStar = std::regex_match(token, procedureOrAirportPattern);
-        }
+        bool isPotentialStar = IsPotentialProcedureToken(token);
 
         // Try parsing as waypoint if it's not an airway or potential STAR
         if (!isAirway && !isPotentialStar &&
-            this->ParseWaypoints(parsedRoute, i, token, previousWaypoint, currentFlightRule)) {
+            this->ParseWaypoints(parsedRoute, i, token, previousWaypoint, currentFlightRule,
+                &routeResolution)) {
+            if (!parsedRoute.greedyPicks.empty()) {
+                parsedRoute.greedyPicks[i] = previousWaypoint;
+            }
             foundFirstWaypoint = true;
             lastWaypointIndex = i;
             continue;
@@ -543,12 +922,17 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
 
         // Handle airway (after checking for waypoint)
         if (isAirway && i > 0 && i < routeParts.size() - 1 && previousWaypoint.has_value()) {
-            const auto& nextToken = routeParts[i + 1];
+            const std::string_view nextToken = routeParts[i + 1];
             // Verify next token isn't a SID/STAR (no '/')
             if (token.find('/') == std::string::npos && nextToken.find('/') == std::string::npos &&
-                !std::regex_match(nextToken, std::regex("[A-Z]{2,5}\\d{1,2}[A-Z]?"))) {
-                if (this->ParseAirway(parsedRoute, i, token, previousWaypoint, nextToken, currentFlightRule)) {
-                    previousWaypoint = NavdataObject::FindClosestWaypointTo(nextToken, previousWaypoint);
+                !std::regex_match(nextToken.begin(), nextToken.end(), procedureNamePattern)) {
+                const auto exitWaypoint = routeResolution.Pick(i + 1, nextToken, previousWaypoint);
+                if (this->ParseAirway(parsedRoute, i, token, previousWaypoint, nextToken,
+                        currentFlightRule, seed ? &seed->airways : nullptr, exitWaypoint)) {
+                    previousWaypoint = exitWaypoint;
+                    if (!parsedRoute.greedyPicks.empty()) {
+                        parsedRoute.greedyPicks[i + 1] = exitWaypoint;
+                    }
                     lastWaypointIndex = i + 1;
                     i++; // Skip the next token since it was the airway endpoint
                     continue;
@@ -561,12 +945,12 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
             std::string tokenToRemove;
             if (this->ParseFirstAndLastPart(parsedRoute, i, token, origin, false, tokenToRemove, currentFlightRule)) {
                 if (!tokenToRemove.empty()) {
-                    tokensToRemove.push_back(tokenToRemove);
+                    tokensToRemove.emplace_back(tokenToRemove);
                 }
                 continue;
             }
             else if (!tokenToRemove.empty()) {
-                tokensToRemove.push_back(tokenToRemove);
+                tokensToRemove.emplace_back(tokenToRemove);
                 continue;
             }
         }
@@ -575,9 +959,10 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
             token != "DCT" && !token.empty() && token != " " && token != "." && token != ".." &&
             token != origin && token != destination) {
 
-            if (std::find(tokensToRemove.begin(), tokensToRemove.end(), token) == tokensToRemove.end()) {
-                std::string tokenType = Utils::DetermineTokenType(token);
-                AddAppropriateError(parsedRoute, i, token, tokenType);
+            if (std::find(tokensToRemove.begin(), tokensToRemove.end(),
+                    std::string_view(token))
+                == tokensToRemove.end()) {
+                AddAppropriateError(parsedRoute, i, token, Utils::DetermineTokenType(token));
             }
         }
 
@@ -588,20 +973,20 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
     // Second pass: Collect all STAR-like tokens and find the best one
     if (lastWaypointIndex >= 0) {
         // First collect all STAR-like tokens that come after the last waypoint
-        std::vector<std::pair<int, std::string>> starCandidates;
+        std::pmr::vector<std::pair<int, std::pmr::string>> starCandidates(arena.get());
         for (auto i = lastWaypointIndex + 1; i < routeParts.size(); i++) {
             const auto& token = routeParts[i];
 
             // Add destination airport codes with runway
-            if (token.length() >= 7 && token.substr(0, 4) == destination && token.find('/') != std::string::npos) {
-                starCandidates.push_back({ i, token });
+            if (token.length() >= 7 && std::string_view(token).substr(0, 4) == destination && token.find('/') != std::string::npos) {
+                starCandidates.emplace_back(i, token);
                 continue;
             }
 
             // Add tokens that look like procedures
             if (token.find('/') != std::string::npos ||
-                std::regex_match(token, std::regex(R"([A-Z]{1,5}\d[A-Z]?(?:.*)?(?:\/\d{2}[LRC]?)?)"))) {
-                starCandidates.push_back({ i, token });
+                std::regex_match(token, starCandidatePattern)) {
+                starCandidates.emplace_back(i, token);
             }
         }
 
@@ -609,19 +994,21 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
         int bestStarQuality = 0;
         std::string bestStarToken;
 
-        for (const auto& [idx, token] : starCandidates) {
+        for (const auto& [idx, candidate] : starCandidates) {
+            const std::string_view token = candidate;
             std::string tokenToRemove;
 
             // Get the procedure match result directly
-            auto procedureResult = SidStarParser::FindProcedure(token, destination, PROCEDURE_STAR, idx);
+            auto procedureResult = SidStarParser::FindProcedure(
+                std::string(token), destination, PROCEDURE_STAR, idx);
 
             // Add any errors from the procedure result
             for (const auto& error : procedureResult.errors) {
-                Utils::InsertParsingErrorIfNotDuplicate(parsedRoute.errors, error);
+                parsedRoute.errors.InsertIfNotDuplicate(error);
 
                 // If we have an airport mismatch, mark the token for removal
                 if (error.type == PROCEDURE_AIRPORT_MISMATCH) {
-                    tokensToRemove.push_back(token);
+                    tokensToRemove.emplace_back(token);
                 }
             }
 
@@ -632,10 +1019,10 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
             int matchQuality = 0;
             if (parsed) {
                 // This token became our STAR or runway
-                if (parsedRoute.STAR.has_value() && parsedRoute.arrivalRunway.has_value()) {
+                if (parsedRoute.STAR && parsedRoute.arrivalRunway.has_value()) {
                     matchQuality = 3;  // Both STAR and runway
                 }
-                else if (parsedRoute.STAR.has_value()) {
+                else if (parsedRoute.STAR) {
                     matchQuality = 2;  // STAR but no runway
                 }
                 else if (parsedRoute.arrivalRunway.has_value()) {
@@ -651,14 +1038,14 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
 
             // Add any token marked for removal
             if (!tokenToRemove.empty()) {
-                tokensToRemove.push_back(tokenToRemove);
+                tokensToRemove.emplace_back(tokenToRemove);
             }
         }
 
         // Remove all STAR candidates except the best one
         for (const auto& [idx, token] : starCandidates) {
-            if (token != bestStarToken && bestStarQuality > 0) {
-                tokensToRemove.push_back(token);
+            if (token != std::string_view(bestStarToken) && bestStarQuality > 0) {
+                tokensToRemove.emplace_back(token);
             }
         }
 
@@ -668,15 +1055,15 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
 
             // Skip tokens that will be removed or have already been processed
             if (std::find(tokensToRemove.begin(), tokensToRemove.end(), token) != tokensToRemove.end() ||
-                token.empty() || token == "DCT" || (bestStarQuality > 0 && token == bestStarToken)) {
+                token.empty() || token == "DCT"
+                || (bestStarQuality > 0 && token == std::string_view(bestStarToken))) {
                 continue;
             }
 
             // Mark as unknown waypoint if not an airway
-            bool isAirway = NavdataObject::GetAirwayNetwork()->airwayExists(token);
+            bool isAirway = airwayTokens[i];
             if (!isAirway) {
-                std::string tokenType = Utils::DetermineTokenType(token);
-                AddAppropriateError(parsedRoute, i, token, tokenType);
+                AddAppropriateError(parsedRoute, i, token, Utils::DetermineTokenType(token));
             }
         }
     }
@@ -721,17 +1108,22 @@ ParsedRoute ParserHandler::ParseRawRoute(std::string route, std::string origin,
     // }
 
     // Add procedure suggestions
-    SidStarParser::AddSugggestedProcedures(
-        parsedRoute, origin, destination, airportConfigurator);
-
-    // Generate explicit segments with SID/STAR and airport connections
-    GenerateExplicitSegments(parsedRoute, origin, destination);
+    if (options.suggestions) {
+        SidStarParser::AddSugggestedProcedures(
+            parsedRoute, origin, destination, airportConfigurator);
+    }
 
+    // Explicit segments with SID/STAR and airport connections are generated on
+    // first use, see GenerateExplicitRoute
+    if (!options.explicitRoute) {
+        parsedRoute.SetExplicitRoute({});
+    }
+    DropErrorMessages(parsedRoute);
     return parsedRoute;
 }
 
 bool RouteParser::ParserHandler::ParseFlightRule(
-    FlightRule& currentFlightRule, int index, std::string token)
+    FlightRule& currentFlightRule, int index, std::string_view token)
 {
     if (token == "IFR") {
         currentFlightRule = IFR;
@@ -745,11 +1137,11 @@ bool RouteParser::ParserHandler::ParseFlightRule(
 }
 
 bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index,
-    std::string token, std::optional<Waypoint>& previousWaypoint,
+    std::string_view routeToken, std::optional<Waypoint>& previousWaypoint,
     FlightRule currentFlightRule)
 {
-    const std::vector<std::string> parts = absl::StrSplit(token, '/');
-    token = parts[0];
+    const std::vector<std::string> parts = absl::StrSplit(routeToken, '/');
+    const std::string& token = parts[0];
     auto match = ctre::match<RouteParser::Regexes::RouteLatLon>(token);
     if (!match) {
         return false;
@@ -765,8 +1157,8 @@ bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index
         const auto lonCardinal = match.get<6>().to_string();
 
         if (latDegrees > 90 || lonDegrees > 180) {
-            parsedRoute.errors.push_back({ INVALID_DATA, "Invalid lat/lon coordinate",
-                index, token, PARSE_ERROR });
+            parsedRoute.errors.push_back(
+                { INVALID_DATA, MESSAGE_INVALID_LATLON, {}, index, token, PARSE_ERROR });
             return false;
         }
 
@@ -783,13 +1175,13 @@ bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index
 
         std::optional<RouteWaypoint::PlannedAltitudeAndSpeed> plannedAltAndSpd
             = std::nullopt;
-        if (parts.size() > 1) {
+        if (parts.size() > 1 && parsedRoute.options.plannedAltitudeAndSpeed) {
             plannedAltAndSpd = this->ParsePlannedAltitudeAndSpeed(index, parts[1]);
             if (!plannedAltAndSpd) {
                 // Misformed second part of waypoint data
-                parsedRoute.errors.push_back(
-                    { INVALID_DATA, "Invalid planned TAS and Altitude, ignoring it.",
-                        index, token + '/' + parts[1], PARSE_ERROR });
+                parsedRoute.errors.push_back({ INVALID_DATA,
+                    MESSAGE_INVALID_PLANNED_POSITION, {}, index, token + '/' + parts[1],
+                    PARSE_ERROR });
             }
         }
 
@@ -801,9 +1193,7 @@ bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index
             RouteWaypoint& prevRouteWaypoint = parsedRoute.waypoints.back();
 
             // Calculate heading from previous to current waypoint
-            double bearing
-                = prevRouteWaypoint.getPosition().bearingTo(routeWaypoint.getPosition());
-            int heading = static_cast<int>(std::round(bearing));
+            int heading = SegmentHeading(parsedRoute, prevRouteWaypoint, routeWaypoint);
 
             ParsedRouteSegment segment{ prevRouteWaypoint, routeWaypoint, "DCT",
                 heading, // Set the heading
@@ -817,7 +1207,7 @@ bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index
     }
     catch (const std::exception& e) {
         parsedRoute.errors.push_back(
-            { INVALID_DATA, "Invalid lat/lon coordinate", index, token, PARSE_ERROR });
+            { INVALID_DATA, MESSAGE_INVALID_LATLON, {}, index, token, PARSE_ERROR });
         Log::error("Error trying to parse lat/lon ({}): {}", token, e.what());
         return false;
     }
@@ -825,11 +1215,13 @@ bool RouteParser::ParserHandler::ParseLatLon(ParsedRoute& parsedRoute, int index
     return false;
 };
 
-bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index, std::string token,
-    std::optional<Waypoint>& previousWaypoint, std::optional<std::string> nextToken,
-    FlightRule currentFlightRule)
+bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index,
+    std::string_view token, std::optional<Waypoint>& previousWaypoint,
+    std::string_view nextToken, FlightRule currentFlightRule,
+    const std::vector<AirwayExpansion>* knownAirways,
+    const std::optional<Waypoint>& exitWaypoint)
 {
-    if (!nextToken || !previousWaypoint) {
+    if (nextToken.empty() || !previousWaypoint) {
         return false;
     }
 
@@ -841,21 +1233,58 @@ bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index, std::string
         return false;
     }
 
-    auto nextWaypoint
-        = NavdataObject::FindClosestWaypointTo(nextToken.value(), previousWaypoint);
+    auto nextWaypoint = exitWaypoint
+        ? exitWaypoint
+        : NavdataObject::FindClosestWaypointTo(std::string(nextToken), previousWaypoint);
     if (!nextWaypoint) {
         return false;
     }
+    const std::string airway(token);
+
+    // Same traversal as in the previous parse, same entry point included
+    if (knownAirways && !parsedRoute.waypoints.empty()) {
+        const auto entry = previousWaypoint->getPosition();
+        for (const auto& known : *knownAirways) {
+            const auto knownEntry = known.entry.getPosition();
+            if (known.airway != token || known.exit != nextToken
+                || known.entry.getIdentifier() != previousWaypoint->getIdentifier()
+                || knownEntry.latitude().degrees() != entry.latitude().degrees()
+                || knownEntry.longitude().degrees() != entry.longitude().degrees()) {
+                continue;
+            }
+            // Entered where another airway ended, from the pick of its exit token. The
+            // recorded entry is where that airway reached it, the same only for a
+            // unique identifier.
+            if (known.chained
+                && NavdataObject::FindWaypointCandidates(known.entry.getIdentifier()).size()
+                    != 1) {
+                continue;
+            }
+
+            RouteWaypoint fromWaypoint = parsedRoute.waypoints.back();
+            for (const auto& segment : known.segments) {
+                RouteWaypoint toWaypoint
+                    = Utils::WaypointToRouteWaypoint(segment.to, currentFlightRule);
+                int heading = SegmentHeading(parsedRoute, fromWaypoint, toWaypoint);
+
+                parsedRoute.waypoints.push_back(toWaypoint);
+                parsedRoute.segments.push_back(ParsedRouteSegment { fromWaypoint,
+                    toWaypoint, airway, heading, segment.minimumLevel });
+                fromWaypoint = toWaypoint;
+            }
+            return true;
+        }
+    }
 
     auto airwaySegments = NavdataObject::GetAirwayNetwork()->validateAirwayTraversal(
-        previousWaypoint.value(), token, nextToken.value(), 99999, navdata);
+        previousWaypoint.value(), airway, std::string(nextToken), 99999, navdata);
 
     for (const auto& error : airwaySegments.errors) {
         ParsingError modifiedError = error;
-        modifiedError.token = token;
+        modifiedError.token = airway;
         modifiedError.level = PARSE_ERROR;
         modifiedError.type = error.type;
-        Utils::InsertParsingErrorIfNotDuplicate(parsedRoute.errors, modifiedError);
+        parsedRoute.errors.InsertIfNotDuplicate(modifiedError);
     }
 
     if (!airwaySegments.segments.empty() && !parsedRoute.waypoints.empty()) {
@@ -869,15 +1298,13 @@ bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index, std::string
                 = Utils::WaypointToRouteWaypoint(segment.to, currentFlightRule);
 
             // Calculate heading
-            double bearing
-                = fromWaypoint.getPosition().bearingTo(toWaypoint.getPosition());
-            int heading = static_cast<int>(std::round(bearing));
+            int heading = SegmentHeading(parsedRoute, fromWaypoint, toWaypoint);
 
             // Add the waypoint to the waypoints list
             parsedRoute.waypoints.push_back(toWaypoint);
 
             // Create and add the segment with the calculated heading
-            ParsedRouteSegment routeSegment{ fromWaypoint, toWaypoint, token,
+            ParsedRouteSegment routeSegment{ fromWaypoint, toWaypoint, airway,
                 heading, // Set the heading
                 static_cast<int>(segment.minimum_level) };
             parsedRoute.segments.push_back(routeSegment);
@@ -894,8 +1321,7 @@ bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index, std::string
         RouteWaypoint toWaypoint
             = Utils::WaypointToRouteWaypoint(*nextWaypoint, currentFlightRule);
 
-        double bearing = fromWaypoint.getPosition().bearingTo(toWaypoint.getPosition());
-        int heading = static_cast<int>(std::round(bearing));
+        int heading = SegmentHeading(parsedRoute, fromWaypoint, toWaypoint);
 
         parsedRoute.waypoints.push_back(toWaypoint);
 
@@ -910,33 +1336,30 @@ bool ParserHandler::ParseAirway(ParsedRoute& parsedRoute, int index, std::string
 void ParserHandler::AddDirectSegment(ParsedRoute& parsedRoute,
     const RouteWaypoint& fromWaypoint, const RouteWaypoint& toWaypoint)
 {
-    double bearing = fromWaypoint.getPosition().bearingTo(toWaypoint.getPosition());
-
-    int heading = static_cast<int>(std::round(bearing));
+    int heading = SegmentHeading(parsedRoute, fromWaypoint, toWaypoint);
 
     ParsedRouteSegment segment{ fromWaypoint, toWaypoint, "DCT", heading, -1 };
     parsedRoute.segments.push_back(segment);
 }
 
-void RouteParser::ParserHandler::GenerateExplicitSegments(
-    ParsedRoute& parsedRoute, const std::string& origin, const std::string& destination)
+ExplicitRoute RouteParser::GenerateExplicitRoute(const ParsedRoute& parsedRoute)
 {
-    // Always clear previous explicit segments and waypoints
-    parsedRoute.explicitSegments.clear();
-    parsedRoute.explicitWaypoints.clear();
+    ExplicitRoute explicitRoute;
+    const std::string& origin = parsedRoute.origin;
+    const std::string& destination = parsedRoute.destination;
 
     FlightRule flightRule = parsedRoute.waypoints.empty()
         ? IFR
         : parsedRoute.waypoints.front().GetFlightRule();
 
-    // Get origin and destination airport waypoints
-    auto originOpt = NavdataObject::FindWaypointByType(origin, AIRPORT);
-    auto destOpt = NavdataObject::FindWaypointByType(destination, AIRPORT);
+    // Origin and destination airport waypoints, as looked up by the parse
+    const auto& originOpt = parsedRoute.originAirport;
+    const auto& destOpt = parsedRoute.destinationAirport;
     if (!originOpt || !destOpt) {
         // If we can't find the airports, just copy the original route
-        parsedRoute.explicitWaypoints = parsedRoute.waypoints;
-        parsedRoute.explicitSegments = parsedRoute.segments;
-        return;
+        explicitRoute.waypoints = parsedRoute.waypoints;
+        explicitRoute.segments = parsedRoute.segments;
+        return explicitRoute;
     }
 
     RouteWaypoint originRtw
@@ -947,17 +1370,16 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
     auto addSegment = [&](const RouteWaypoint& from, const RouteWaypoint& to,
         const std::string& airway = "DCT", int minLevel = -1) {
             // Calculate heading
-            double bearing = from.getPosition().bearingTo(to.getPosition());
-            int heading = static_cast<int>(std::round(bearing));
+            int heading = SegmentHeading(parsedRoute, from, to);
 
-            parsedRoute.explicitSegments.push_back({ from, to, airway, heading, minLevel });
+            explicitRoute.segments.push_back({ from, to, airway, heading, minLevel });
         };
 
     // Helper lambda to process a procedure (SID or STAR)
     auto applyProcedure
-        = [&](const std::optional<Procedure>& procOpt,
+        = [&](const ProcedurePtr& procOpt,
             const std::vector<RouteWaypoint>& routeWpts, bool isSID) -> bool {
-                if (!procOpt.has_value() || procOpt->waypoints.empty())
+                if (!procOpt || procOpt->waypoints.empty())
                     return false;
 
                 std::vector<RouteWaypoint> procWpts;
@@ -977,7 +1399,7 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                             if (rwp.getIdentifier() == procWpts[i].getIdentifier()) {
                                 sidConnIdx = i;
                                 connId = procWpts[i].getIdentifier();
-                                parsedRoute.sidConnectionWaypoint = connId;
+                                explicitRoute.sidConnectionWaypoint = connId;
                                 break;
                             }
                         }
@@ -991,7 +1413,7 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                             break;
                         if (i > 0)
                             addSegment(procWpts[i - 1], procWpts[i]);
-                        parsedRoute.explicitWaypoints.push_back(procWpts[i]);
+                        explicitRoute.waypoints.push_back(procWpts[i]);
                     }
 
                     // Now add remaining FP waypoints after the connection point.
@@ -1017,7 +1439,7 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                                     (i - 1 < parsedRoute.segments.size()
                                         ? parsedRoute.segments[i - 1].minimumLevel
                                         : -1));
-                            parsedRoute.explicitWaypoints.push_back(routeWpts[i]);
+                            explicitRoute.waypoints.push_back(routeWpts[i]);
                         }
                     }
                 }
@@ -1026,9 +1448,9 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                     size_t procConnIdx = 0;
                     bool found = false;
                     // Iterate the explicit waypoints in reverse order.
-                    for (size_t j = parsedRoute.explicitWaypoints.size(); j-- > 0;) {
+                    for (size_t j = explicitRoute.waypoints.size(); j-- > 0;) {
                         for (size_t i = 0; i < procWpts.size(); i++) {
-                            if (parsedRoute.explicitWaypoints[j].getIdentifier()
+                            if (explicitRoute.waypoints[j].getIdentifier()
                                 == procWpts[i].getIdentifier()) {
                                 explicitConnIdx = j;
                                 procConnIdx = i;
@@ -1040,24 +1462,24 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                             break;
                     }
                     if (found) {
-                        parsedRoute.explicitWaypoints.resize(explicitConnIdx + 1);
-                        parsedRoute.explicitSegments.resize(explicitConnIdx);
+                        explicitRoute.waypoints.resize(explicitConnIdx + 1);
+                        explicitRoute.segments.resize(explicitConnIdx);
 
                         // Then add STAR waypoints after the connection point.
                         for (size_t i = procConnIdx + 1; i < procWpts.size(); i++) {
                             RouteWaypoint prev
-                                = (i == procConnIdx + 1 ? parsedRoute.explicitWaypoints.back()
+                                = (i == procConnIdx + 1 ? explicitRoute.waypoints.back()
                                     : procWpts[i - 1]);
                             addSegment(prev, procWpts[i]);
-                            parsedRoute.explicitWaypoints.push_back(procWpts[i]);
+                            explicitRoute.waypoints.push_back(procWpts[i]);
                         }
                     }
                     else {
-                        addSegment(parsedRoute.explicitWaypoints.back(), procWpts.front());
+                        addSegment(explicitRoute.waypoints.back(), procWpts.front());
                         for (size_t i = 0; i < procWpts.size(); i++) {
                             if (i > 0)
                                 addSegment(procWpts[i - 1], procWpts[i]);
-                            parsedRoute.explicitWaypoints.push_back(procWpts[i]);
+                            explicitRoute.waypoints.push_back(procWpts[i]);
                         }
                     }
                 }
@@ -1065,13 +1487,13 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
         };
 
     // Always start with the origin airport.
-    parsedRoute.explicitWaypoints.push_back(originRtw);
+    explicitRoute.waypoints.push_back(originRtw);
 
     // 1. DEPARTURE: Handle SID if available; otherwise, add a direct connection to the
     // first FP waypoint.
     if (!parsedRoute.waypoints.empty()) {
         if (!applyProcedure(
-            parsedRoute.SID.has_value() ? parsedRoute.SID : parsedRoute.suggestedSID,
+            parsedRoute.SID ? parsedRoute.SID : parsedRoute.suggestedSID,
             parsedRoute.waypoints, true)) {
             addSegment(originRtw, parsedRoute.waypoints.front());
             for (size_t i = 0; i < parsedRoute.waypoints.size(); i++) {
@@ -1083,7 +1505,7 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
                         (i - 1 < parsedRoute.segments.size()
                             ? parsedRoute.segments[i - 1].minimumLevel
                             : -1));
-                parsedRoute.explicitWaypoints.push_back(parsedRoute.waypoints[i]);
+                explicitRoute.waypoints.push_back(parsedRoute.waypoints[i]);
             }
         }
     }
@@ -1091,16 +1513,18 @@ void RouteParser::ParserHandler::GenerateExplicitSegments(
     // 2. ARRIVAL: Process STAR procedure (using the modified logic to pick the last FP
     // waypoint in the STAR).
     applyProcedure(
-        parsedRoute.STAR.has_value() ? parsedRoute.STAR : parsedRoute.suggestedSTAR,
-        parsedRoute.explicitWaypoints, false);
+        parsedRoute.STAR ? parsedRoute.STAR : parsedRoute.suggestedSTAR,
+        explicitRoute.waypoints, false);
 
     // 3. Ensure the destination is the final waypoint.
-    if (parsedRoute.explicitWaypoints.empty()
-        || parsedRoute.explicitWaypoints.back().getIdentifier() != destination) {
-        RouteWaypoint lastWp = parsedRoute.explicitWaypoints.empty()
+    if (explicitRoute.waypoints.empty()
+        || explicitRoute.waypoints.back().getIdentifier() != destination) {
+        RouteWaypoint lastWp = explicitRoute.waypoints.empty()
             ? originRtw
-            : parsedRoute.explicitWaypoints.back();
+            : explicitRoute.waypoints.back();
         addSegment(lastWp, destRtw);
-        parsedRoute.explicitWaypoints.push_back(destRtw);
+        explicitRoute.waypoints.push_back(destRtw);
     }
-}
\ No newline at end of file
+
+    return explicitRoute;
+}
@@ -1,4 +1,5 @@
 #include "RouteHandler.h"
+#include <fmt/format.h>
 
 std::shared_ptr<RouteParser::ParserHandler> RouteHandler::GetParser() { return this->parser; }
 
@@ -7,4 +8,16 @@ std::shared_ptr<RouteParser::AirportConfigurator> RouteHandler::GetAirportConfig
     return this->airportConfigurator;
 }
 
-std::shared_ptr<RouteParser::NavdataObject> RouteHandler::GetNavdata() { return this->navdata; }
\ No newline at end of file
+std::shared_ptr<RouteParser::NavdataObject> RouteHandler::GetNavdata() { return this->navdata; }
+
+size_t RouteHandler::CountRows(const std::string& dbPath, const std::string& table)
+{
+    try {
+        SQLite::Database db(dbPath, SQLite::OPEN_READONLY);
+        SQLite::Statement query(db, fmt::format("SELECT COUNT(*) FROM \"{}\"", table));
+        return query.executeStep() ? static_cast<size_t>(query.getColumn(0).getInt64()) : 0;
+    } catch (const std::exception& e) {
+        Log::warn("Could not count the rows of {} in {}: {}", table, dbPath, e.what());
+        return 0;
+    }
+}
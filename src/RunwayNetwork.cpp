@@ -242,6 +242,7 @@ namespace RouteParser
 
         if (useCache_)
         {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
             auto it = cache_.find(airportIdent);
             if (it != cache_.end())
             {
@@ -331,6 +332,7 @@ namespace RouteParser
 
             if (useCache_ && !runways.empty())
             {
+                std::lock_guard<std::mutex> lock(cacheMutex_);
                 cache_[airportIdent] = runways;
             }
         }
@@ -368,6 +370,7 @@ namespace RouteParser
     {
         try
         {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
             cache_.clear();
         }
         catch (const std::exception& e)
@@ -376,4 +379,27 @@ namespace RouteParser
         }
     }
 
+    MemoryUsageEntry RunwayNetwork::memoryUsage() const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        size_t runways = 0;
+        for (const auto& [airport, airportRunways] : cache_)
+        {
+            runways += airportRunways.size();
+        }
+        return {"runway cache", runways, MemoryEstimate::HeapBytes(cache_)};
+    }
+
+    std::vector<std::string> RunwayNetwork::cachedKeys() const
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        std::vector<std::string> keys;
+        keys.reserve(cache_.size());
+        for (const auto& [key, _] : cache_)
+        {
+            keys.push_back(key);
+        }
+        return keys;
+    }
+
 } // namespace RouteParser
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "Helpers/AllocationCounter.h"
+#include "Helpers/SampleRunways.h"
+#include "RouteHandler.h"
+#include "types/ParsedRoute.h"
+#include <gtest/gtest.h>
+#include <string>
+using namespace RouteParser;
+
+namespace RouteHandlerTests
+{
+    // Heap allocation budgets of the hot paths. A failure here means a change added
+    // allocations, raise a budget only when that is intended.
+    class AllocationBudgetTest : public ::testing::Test
+    {
+    protected:
+        RouteHandler handler;
+
+        void SetUp() override
+        {
+            // Handlers share the navdata, each test starts from an empty network
+            NavdataObject::Reset();
+            handler.Bootstrap([](const char*, const char*) {}, "testdata/navdata.db",
+                {}, "testdata/airways.db");
+
+            ActivateSampleRunways(handler);
+        }
+
+        // Allocations of the second call, the first one warms up lazy state
+        template <typename Function>
+        size_t CountAllocations(Function function)
+        {
+            function();
+            AllocationCounter counter;
+            function();
+            return counter.Count();
+        }
+    };
+
+    TEST_F(AllocationBudgetTest, CounterSeesAllocations)
+    {
+        // Direct calls, unlike new expressions these cannot be optimised away
+        AllocationCounter counter;
+        void* single = ::operator new(16);
+        void* array = ::operator new[](64);
+        EXPECT_EQ(counter.Count(), 2);
+        EXPECT_EQ(counter.Bytes(), 80);
+        ::operator delete(single);
+        ::operator delete[](array);
+    }
+
+    TEST_F(AllocationBudgetTest, RunwayAndProcedureLookups)
+    {
+        auto configurator = handler.GetAirportConfigurator();
+        EXPECT_EQ(CountAllocations([&]() { configurator->GetDepartureRunways("ZSNJ"); }), 0);
+        EXPECT_EQ(CountAllocations([&]() { NavdataObject::GetAirportProcedures("ZSNJ"); }), 0);
+    }
+
+    TEST_F(AllocationBudgetTest, WaypointLookup)
+    {
+        // The returned waypoint owns its identifier and name, nothing else allocates
+        EXPECT_LE(CountAllocations([]() { NavdataObject::FindWaypoint("TESIG"); }), 2);
+    }
+
+    TEST_F(AllocationBudgetTest, CachedParseResult)
+    {
+        auto parser = handler.GetParser();
+        parser->EnableResultCache(8);
+        // Cleaning the route and building the cache key
+        EXPECT_LE(CountAllocations([&]() {
+            parser->ParseRawRouteShared("TESIG A470 DOTMI V512 ABBEY", "ZSNJ", "VHHH");
+        }), 8);
+    }
+
+    TEST_F(AllocationBudgetTest, TwentyTokenRoute)
+    {
+        const std::string route = "TESIG A470 DOTMI V512 ABBEY DCT TESIG A470 DOTMI V512 "
+                                  "ABBEY DCT TESIG A470 DOTMI V512 ABBEY DCT TESIG A470";
+        auto parser = handler.GetParser();
+        // About 200 of each, the margin covers other standard libraries
+        EXPECT_LE(CountAllocations([&]() { parser->ParseRawRoute(route, "ZSNJ", "VHHH"); }),
+            220);
+        EXPECT_LE(CountAllocations([&]() {
+            parser->ParseRawRoute(route, "ZSNJ", "VHHH", IFR, ParseOptions::ValidationOnly());
+        }), 220);
+    }
+}
@@ -0,0 +1,141 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+// Global allocation hooks of the test executable. Only the allocations of threads
+// with a live AllocationCounter are counted, everything else goes straight through.
+
+namespace
+{
+    thread_local size_t activeCounters = 0;
+    thread_local size_t allocationCount = 0;
+    thread_local size_t allocatedBytes = 0;
+
+    void Count(size_t size)
+    {
+        if (activeCounters > 0)
+        {
+            allocationCount++;
+            allocatedBytes += size;
+        }
+    }
+
+    void* Allocate(size_t size)
+    {
+        Count(size);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* AllocateAligned(size_t size, std::align_val_t alignment)
+    {
+        Count(size);
+        const auto align = static_cast<size_t>(alignment);
+        const size_t bytes = size == 0 ? 1 : size;
+#ifdef _WIN32
+        return _aligned_malloc(bytes, align);
+#else
+        // aligned_alloc wants a multiple of the alignment
+        return std::aligned_alloc(align, (bytes + align - 1) / align * align);
+#endif
+    }
+
+    void FreeAligned(void* pointer)
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+namespace RouteHandlerTests
+{
+    AllocationCounter::AllocationCounter()
+        : startCount(allocationCount), startBytes(allocatedBytes)
+    {
+        activeCounters++;
+    }
+
+    AllocationCounter::~AllocationCounter()
+    {
+        activeCounters--;
+    }
+
+    size_t AllocationCounter::Count() const
+    {
+        return allocationCount - startCount;
+    }
+
+    size_t AllocationCounter::Bytes() const
+    {
+        return allocatedBytes - startBytes;
+    }
+}
+
+void* operator new(size_t size)
+{
+    if (void* pointer = Allocate(size))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = AllocateAligned(size, alignment))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { FreeAligned(pointer); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
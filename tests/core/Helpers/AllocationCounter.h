@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+
+namespace RouteHandlerTests
+{
+    /**
+     * @class AllocationCounter
+     * @brief Counts the heap allocations made by the current thread while in scope.
+     *
+     * Backed by the global operator new replacement of the test executable, see
+     * AllocationCounter.cpp. Counters can be nested, each one counts from its own
+     * construction.
+     */
+    class AllocationCounter
+    {
+    public:
+        AllocationCounter();
+        ~AllocationCounter();
+
+        AllocationCounter(const AllocationCounter&) = delete;
+        AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+        // Allocations since construction
+        size_t Count() const;
+        // Bytes requested since construction
+        size_t Bytes() const;
+
+    private:
+        size_t startCount;
+        size_t startBytes;
+    };
+}
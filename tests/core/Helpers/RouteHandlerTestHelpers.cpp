@@ -18,7 +18,7 @@ static void PRINT_ALL_PARSING_ERRORS(const ParsedRoute& parsedRoute)
         else {
             fmt::print(fg(fmt::color::dark_red) | fmt::emphasis::bold, "ERROR: ");
         }
-        fmt::print("{} | Token index {} | Raw token {}\n", error.message,
+        fmt::print("{} | Token index {} | Raw token {}\n", error.GetMessage(),
             error.tokenIndex, error.token);
     }
     fmt::print(fg(fmt::color::orange) | fmt::emphasis::bold,
@@ -66,14 +66,14 @@ static void EXPECT_BASIC_ROUTE(ParsedRoute parsedRoute)
     EXPECT_PARSE_ERROR_OF_TYPE(parsedRoute, ParsingErrorType::UNKNOWN_PROCEDURE, 0);
 
     // Check for SID procedure
-    ASSERT_TRUE(parsedRoute.SID.has_value());
+    ASSERT_TRUE(parsedRoute.SID != nullptr);
     EXPECT_EQ(parsedRoute.SID->name, "TES61X");
 
     // Check departure runway
     EXPECT_EQ(parsedRoute.departureRunway, "06");
 
     // Check for STAR procedure
-    ASSERT_TRUE(parsedRoute.STAR.has_value());
+    ASSERT_TRUE(parsedRoute.STAR != nullptr);
     EXPECT_EQ(parsedRoute.STAR->name, "ABBEY3A");
 
     // Check arrival runway
@@ -0,0 +1,17 @@
+#pragma once
+#include "RouteHandler.h"
+#include <string>
+#include <unordered_map>
+
+namespace RouteHandlerTests
+{
+    // ZSNJ 06 and VHHH 07R active both ways, the runways of the sample routes, so
+    // their SID, STAR and suggestions are all filled in
+    inline void ActivateSampleRunways(RouteHandler& handler)
+    {
+        std::unordered_map<std::string, RouteParser::AirportRunways> airportRunways;
+        airportRunways["ZSNJ"] = { { "06" }, { "06" } };
+        airportRunways["VHHH"] = { { "07R" }, { "07R" } };
+        handler.GetAirportConfigurator()->UpdateAirportRunways(airportRunways);
+    }
+}
@@ -1,15 +1,94 @@
+#include "Helpers/AllocationCounter.h"
 #include "Helpers/RouteHandlerTestHelpers.cpp"
+#include "JsonWriter.h"
+#include "ParseArena.h"
+#include "RouteCodec.h"
 #include "RouteHandler.h"
+#include "TemporaryPath.h"
+#include "types/CompactParsedRoute.h"
 #include "types/ParsedRoute.h"
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <fmt/color.h>
 #include <fmt/core.h>
 #include <gtest/gtest.h>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace RouteParser;
 
 namespace RouteHandlerTests
 {
+  // Runway storage as it was before the configuration snapshots, kept as the
+  // reference for the contention benchmark
+  class MutexRunwayStore
+  {
+  public:
+    void Update(const std::unordered_map<std::string, AirportRunways> &airportRunways)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      runways_ = airportRunways;
+    }
+
+    std::vector<std::string> GetDepartureRunways(const std::string &icao) const
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = runways_.find(icao);
+      if (it != runways_.end())
+      {
+        return it->second.depRunways;
+      }
+      return {};
+    }
+
+  private:
+    std::unordered_map<std::string, AirportRunways> runways_;
+    mutable std::mutex mutex_;
+  };
+
+  // Runs the reader on several threads at once, returns the wall time in ms
+  template <typename Reader>
+  double TimeConcurrentReads(int threadCount, int iterations, Reader reader)
+  {
+    std::vector<std::thread> threads;
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; t++)
+    {
+      threads.emplace_back([&]()
+                           {
+        for (int i = 0; i < iterations; i++) {
+          reader();
+        } });
+    }
+    for (auto &thread : threads)
+    {
+      thread.join();
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+  }
+
+  // Runs the work on this thread, returns the mean time of one run in ms
+  template <typename Work>
+  double TimePerRun(int iterations, Work work)
+  {
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+      work();
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count() / iterations;
+  }
+
   class PerformanceTest : public ::testing::Test
   {
   protected:
@@ -17,10 +96,393 @@ namespace RouteHandlerTests
 
     void SetUp() override
     {
-      // Any setup needed before each test
+      // Handlers share the navdata, each test starts from an empty network
+      NavdataObject::Reset();
+      handler.Bootstrap([](const char *, const char *) {}, "testdata/navdata.db",
+                        {}, "testdata/airways.db");
     }
   };
 
+  TEST_F(PerformanceTest, RunwayReadsUnderContention)
+  {
+    std::unordered_map<std::string, AirportRunways> airportRunways;
+    airportRunways["EGLL"] = {{"27R", "27L"}, {"27L"}};
+    airportRunways["LFPG"] = {{"09L", "08R"}, {"08R", "09R"}};
+    airportRunways["ZSNJ"] = {{"06"}, {"06"}};
+
+    MutexRunwayStore mutexStore;
+    mutexStore.Update(airportRunways);
+    AirportConfigurator configurator;
+    configurator.UpdateAirportRunways(airportRunways);
+
+    const int threadCount = std::clamp<int>(std::thread::hardware_concurrency(), 2, 8);
+    const int iterations = 100000;
+    std::atomic<size_t> sink = 0;
+
+    // Best of several alternating rounds, so a scheduling hiccup hits neither side alone
+    const int rounds = 5;
+    double mutexMs = std::numeric_limits<double>::max();
+    double snapshotMs = std::numeric_limits<double>::max();
+    for (int round = 0; round < rounds; round++)
+    {
+      mutexMs = std::min(mutexMs, TimeConcurrentReads(threadCount, iterations, [&]()
+                                                      { sink += mutexStore.GetDepartureRunways("LFPG").size(); }));
+      snapshotMs = std::min(snapshotMs, TimeConcurrentReads(threadCount, iterations, [&]()
+                                                            { sink += configurator.GetDepartureRunways("LFPG").size(); }));
+    }
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Runway reads, {} threads x {}: mutex {:.1f} ms, snapshot {:.1f} ms\n",
+               threadCount, iterations, mutexMs, snapshotMs);
+
+    EXPECT_EQ(sink.load(), 2ull * 2 * threadCount * iterations * rounds);
+    // Readers never lock, they must not be slower than the mutex they replaced
+    EXPECT_LE(snapshotMs, mutexMs);
+    auto runways = configurator.GetDepartureRunways("LFPG");
+    ASSERT_EQ(runways.size(), 2);
+    EXPECT_EQ(runways[1], "08R");
+  }
+
+  TEST_F(PerformanceTest, WaypointResolutionGreedyVsRoute)
+  {
+    // Ambiguous identifiers spread over the globe, as with NDB idents
+    std::vector<Waypoint> waypoints;
+    std::string route;
+    for (int token = 0; token < 20; token++)
+    {
+      const std::string identifier = fmt::format("AMB{:02}", token);
+      for (int candidate = 0; candidate < 8; candidate++)
+      {
+        waypoints.emplace_back(FIX, identifier, identifier,
+                               erkir::spherical::Point(-60.0 + candidate * 15.0, candidate * 40.0 - 140.0 + token * 2.0));
+      }
+      route += identifier + " ";
+    }
+    NavdataObject::LoadNseWaypoints(waypoints, "resolution-benchmark");
+
+    auto parser = handler.GetParser();
+    const int iterations = 50;
+    auto timeParses = [&](WaypointResolutionMode mode)
+    {
+      parser->SetWaypointResolution(mode);
+      return TimePerRun(iterations, [&]()
+                        {
+        auto parsedRoute = parser->ParseRawRoute(route, "ZSNJ", "VHHH");
+        EXPECT_EQ(parsedRoute.waypoints.size(), 20); });
+    };
+
+    const double greedyMs = timeParses(RESOLVE_GREEDY);
+    const double routeMs = timeParses(RESOLVE_ROUTE);
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Waypoint resolution, 20 tokens x 8 candidates: greedy {:.3f} ms, route {:.3f} ms per parse\n",
+               greedyMs, routeMs);
+  }
+
+  // Evicts the file from the OS page cache, its next reads go to the disk. Only on
+  // Linux, elsewhere the file stays cached.
+  void DropFromPageCache(const std::string &path)
+  {
+#ifdef __linux__
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+#endif
+  }
+
+  TEST_F(PerformanceTest, ColdCacheParseWithPrefetch)
+  {
+    // A copy with enough waypoints that each lookup reads pages of its own
+    const auto path = TemporaryPathFor(
+        (std::filesystem::temp_directory_path() / "routeparser_cold_airways.db").string());
+    std::filesystem::copy_file("testdata/airways.db", path);
+    const int waypointCount = 200000;
+    {
+      SQLite::Database db(path, SQLite::OPEN_READWRITE);
+      SQLite::Transaction transaction(db);
+      SQLite::Statement insert(db, "INSERT INTO waypoints (identifier, latitude, longitude) VALUES (?, ?, ?)");
+      for (int i = 0; i < waypointCount; i++)
+      {
+        insert.bind(1, fmt::format("WP{:06}", i));
+        insert.bind(2, (i % 1800) / 10.0 - 90.0);
+        insert.bind(3, (i % 3600) / 10.0 - 180.0);
+        insert.exec();
+        insert.reset();
+      }
+      transaction.commit();
+    }
+    // Each parse looks up waypoints of index and table pages no earlier parse read,
+    // a page holding a few hundred of them
+    int nextWaypoint = 0;
+    auto nextRoute = [&]()
+    {
+      std::string route;
+      for (int token = 0; token < 20; token++)
+      {
+        route += fmt::format("WP{:06} ", token * (waypointCount / 20) + nextWaypoint);
+      }
+      nextWaypoint += 300;
+      return route;
+    };
+
+    NavdataObject::Reset();
+    NavdataObject::LoadAirwayNetwork(path);
+    auto parser = handler.GetParser();
+    const int iterations = 16;
+    double sequentialMs = 0;
+    double prefetchMs = 0;
+    // Alternated, both see the same disk
+    for (int i = 0; i < iterations; i++)
+    {
+      for (const size_t threads : {size_t{0}, size_t{4}})
+      {
+        parser->EnablePrefetch(threads);
+        const auto route = nextRoute();
+        DropFromPageCache(path);
+        (threads ? prefetchMs : sequentialMs) += TimePerRun(1, [&]()
+                                                            {
+          auto parsedRoute = parser->ParseRawRoute(route, "ZSNJ", "VHHH");
+          EXPECT_EQ(parsedRoute.waypoints.size(), 20); });
+      }
+    }
+    parser->EnablePrefetch(0);
+    NavdataObject::Reset();
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Cold page cache, 20 of {} waypoints: sequential {:.3f} ms, prefetched {:.3f} ms per parse\n",
+               waypointCount, sequentialMs / iterations, prefetchMs / iterations);
+    for (const auto *suffix : {"", "-wal", "-shm"})
+    {
+      std::filesystem::remove(path + suffix);
+    }
+  }
+
+  TEST_F(PerformanceTest, ParseOptionsPresets)
+  {
+    auto parser = handler.GetParser();
+    const std::string route = "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R";
+    const int iterations = 200;
+    auto timeParses = [&](const ParseOptions &options)
+    {
+      return TimePerRun(iterations, [&]()
+                        {
+        auto parsedRoute = parser->ParseRawRoute(route, "ZSNJ", "VHHH", IFR, options);
+        // The explicit route is lazy, count it where it is wanted
+        EXPECT_EQ(parsedRoute.GetExplicitWaypoints().empty(), !options.explicitRoute); });
+    };
+
+    const double fullMs = timeParses(ParseOptions::Full());
+    const double validationMs = timeParses(ParseOptions::ValidationOnly());
+    const double displayMs = timeParses(ParseOptions::DisplayOnly());
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Parse options: full {:.3f} ms, validation {:.3f} ms, display {:.3f} ms per parse\n",
+               fullMs, validationMs, displayMs);
+  }
+
+  TEST_F(PerformanceTest, ConcurrentParses)
+  {
+    auto parser = handler.GetParser();
+    const std::string route = "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R";
+    const int iterations = 100;
+    std::atomic<size_t> sink = 0;
+    auto parse = [&]()
+    { sink += parser->ParseRawRoute(route, "ZSNJ", "VHHH").waypoints.size(); };
+
+    const double singleMs = TimeConcurrentReads(1, iterations, parse);
+    const int threadCount = std::clamp<int>(std::thread::hardware_concurrency(), 2, 8);
+    const double concurrentMs = TimeConcurrentReads(threadCount, iterations, parse);
+
+    // The scratch data of the route, in the arena of a parse and on the shared heap
+    const std::vector<std::string_view> parts = absl::StrSplit(route, ' ');
+    const auto scratchAllocations = [&](std::pmr::memory_resource *resource)
+    {
+      AllocationCounter counter;
+      RouteTokens tokens(resource);
+      for (const auto part : parts)
+      {
+        tokens.emplace_back(part);
+      }
+      std::pmr::vector<bool> airwayTokens(tokens.size(), false, resource);
+      ResolvedWaypoints picks(tokens.size(), resource);
+      WaypointCandidates candidates(tokens.size(), resource);
+      return counter.Count();
+    };
+    ParseArena arena;
+    const size_t arenaAllocations = scratchAllocations(arena.get());
+    const size_t heapAllocations = scratchAllocations(std::pmr::new_delete_resource());
+
+    AllocationCounter counter;
+    parse();
+    const size_t parseAllocations = counter.Count();
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Parses x {}: 1 thread {:.1f} ms, {} threads {:.1f} ms, {} allocations per "
+               "parse, scratch data {} allocations in the arena, {} on the heap\n",
+               iterations, singleMs, threadCount, concurrentMs, parseAllocations,
+               arenaAllocations, heapAllocations);
+    EXPECT_GT(sink.load(), 0);
+    EXPECT_EQ(arenaAllocations, 0);
+    EXPECT_GE(heapAllocations, 4);
+  }
+
+  TEST_F(PerformanceTest, CompactRouteCopies)
+  {
+    // 150 fixes along airways, with a planned level on every tenth
+    ParsedRoute parsedRoute;
+    for (int i = 0; i < 150; i++)
+    {
+      const std::string identifier = fmt::format("FIX{:03}", i);
+      std::optional<RouteWaypoint::PlannedAltitudeAndSpeed> planned;
+      if (i % 10 == 0)
+      {
+        planned = RouteWaypoint::PlannedAltitudeAndSpeed{35000, 450};
+      }
+      parsedRoute.waypoints.emplace_back(FIX, identifier,
+                                         erkir::spherical::Point(40.0 + i * 0.1, 10.0 + i * 0.1), 0, IFR, planned);
+      if (i > 0)
+      {
+        parsedRoute.segments.push_back({parsedRoute.waypoints[i - 1], parsedRoute.waypoints[i],
+                                        fmt::format("UN{}", i / 20), 45, -1});
+      }
+    }
+    parsedRoute.SetExplicitRoute({parsedRoute.segments, parsedRoute.waypoints});
+    auto compact = CompactParsedRoute::FromParsedRoute(parsedRoute);
+    EXPECT_EQ(compact.waypointPool.size(), 150);
+    EXPECT_EQ(compact.airwayNames.size(), 8);
+
+    const int iterations = 1000;
+    auto timeCopies = [&](auto copyRoute)
+    {
+      size_t sink = 0;
+      const double copyMs = TimePerRun(iterations, [&]()
+                                       { sink += copyRoute(); });
+      EXPECT_EQ(sink, 149ull * iterations);
+      return copyMs * 1000;
+    };
+
+    // Copies of a ParsedRoute share the explicit route, copied here for a deep copy
+    const double parsedUs = timeCopies([&]()
+                                       {
+      auto copy = parsedRoute;
+      copy.SetExplicitRoute(parsedRoute.GetExplicitRoute());
+      return copy.segments.size(); });
+    const double compactUs = timeCopies([&]()
+                                        {
+      auto copy = compact;
+      return copy.segments.size(); });
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "150 fix route copy: ParsedRoute {:.1f} us, CompactParsedRoute {:.1f} us\n",
+               parsedUs, compactUs);
+  }
+
+  TEST_F(PerformanceTest, GarbageRouteStaysLinear)
+  {
+    // Unknown procedure-like tokens after a waypoint, the cleanup removes each one
+    // and its errors. The parse waits on a database lookup per token and is only
+    // reported, the cleanup is timed on copies of its result.
+    auto parser = handler.GetParser();
+    auto parseGarbage = [&](int tokenCount, double &parseMs)
+    {
+      std::string route = "TESIG";
+      for (int token = 0; token < tokenCount; token++)
+      {
+        route += fmt::format(" {}{}{:02}C", char('A' + token % 26),
+                             char('A' + token / 26 % 26), token % 100);
+      }
+      ParsedRoute parsedRoute;
+      parseMs = TimePerRun(1, [&]()
+                           { parsedRoute = parser->ParseRawRoute(route, "ZSNJ", "VHHH"); });
+      EXPECT_GE(parsedRoute.errors.size(), tokenCount);
+      return parsedRoute;
+    };
+    auto timeCleanup = [&](const ParsedRoute &parsedRoute)
+    {
+      auto cleaned = parsedRoute;
+      const double cleanupMs = TimePerRun(1, [&]()
+                                          { parser->CleanupUnrecognizedPatterns(cleaned, "ZSNJ", "VHHH"); });
+      EXPECT_EQ(cleaned.rawRoute, "TESIG");
+      EXPECT_TRUE(cleaned.errors.empty());
+      return cleanupMs;
+    };
+
+    double smallParseMs = 0;
+    double largeParseMs = 0;
+    const auto small = parseGarbage(250, smallParseMs);
+    const auto large = parseGarbage(1000, largeParseMs);
+
+    // Best of several alternating rounds, so a scheduling hiccup hits neither side alone
+    double smallCleanupMs = std::numeric_limits<double>::max();
+    double largeCleanupMs = std::numeric_limits<double>::max();
+    for (int round = 0; round < 9; round++)
+    {
+      smallCleanupMs = std::min(smallCleanupMs, timeCleanup(small));
+      largeCleanupMs = std::min(largeCleanupMs, timeCleanup(large));
+    }
+
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Garbage route: 250 tokens parse {:.2f} ms cleanup {:.2f} ms, 1000 tokens "
+               "parse {:.2f} ms cleanup {:.2f} ms\n",
+               smallParseMs, smallCleanupMs, largeParseMs, largeCleanupMs);
+    EXPECT_LE(largeCleanupMs, 4 * smallCleanupMs);
+  }
+
+  TEST_F(PerformanceTest, JsonWriterVsNlohmann)
+  {
+    auto parsedRoute = handler.GetParser()->ParseRawRoute(
+        "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+    parsedRoute.GetExplicitRoute();
+
+    const int iterations = 2000;
+    size_t bytes = 0;
+    const double nlohmannUs = 1000 * TimePerRun(iterations, [&]()
+                                                { bytes += nlohmann::json(parsedRoute).dump().size(); });
+
+    std::string buffer;
+    const double writerUs = 1000 * TimePerRun(iterations, [&]()
+                                              {
+      buffer.clear();
+      WriteParsedRouteJson(parsedRoute, buffer);
+      bytes -= buffer.size(); });
+
+    EXPECT_EQ(bytes, 0);
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "JSON of a {} byte route: nlohmann {:.1f} us, streaming writer {:.1f} us\n",
+               buffer.size(), nlohmannUs, writerUs);
+  }
+
+  TEST_F(PerformanceTest, RouteCodecVsJson)
+  {
+    auto parsedRoute = handler.GetParser()->ParseRawRoute(
+        "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+    parsedRoute.GetExplicitRoute();
+
+    const int iterations = 2000;
+    const auto json = nlohmann::json(parsedRoute).dump();
+    size_t waypoints = 0;
+    const double jsonUs = 1000 * TimePerRun(iterations, [&]()
+                                            {
+      const auto text = nlohmann::json(parsedRoute).dump();
+      waypoints += nlohmann::json::parse(text).get<ParsedRoute>().waypoints.size(); });
+
+    std::string encoded;
+    const double codecUs = 1000 * TimePerRun(iterations, [&]()
+                                             {
+      encoded.clear();
+      EncodeParsedRoute(parsedRoute, encoded);
+      waypoints -= DecodeParsedRoute(encoded).waypoints.size(); });
+
+    EXPECT_EQ(waypoints, 0);
+    EXPECT_LT(encoded.size() * 4, json.size());
+    fmt::print(fmt::fg(fmt::color::cyan),
+               "Route round trip: JSON {} bytes {:.1f} us, binary {} bytes {:.1f} us\n",
+               json.size(), jsonUs, encoded.size(), codecUs);
+  }
+
   // TEST_F(PerformanceTest, BasicRouteWithSIDAndSTAR)
   // {
   //   const auto startTime = std::chrono::steady_clock::now();
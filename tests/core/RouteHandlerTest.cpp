@@ -1,14 +1,29 @@
+#include "JsonWriter.h"
+#include "NavdataImage.h"
+#include "RouteCodec.h"
 #include "RouteHandler.h"
+#include "RouteRing.h"
+#include "SharedSnapshot.h"
+#include "types/CompactParsedRoute.h"
 #include "Data/SampleNavdata.cpp"
 #include "Helpers/RouteHandlerTestHelpers.cpp"
+#include "Helpers/SampleRunways.h"
 #include "types/ParsedRoute.h"
 #include "types/ParsingError.h"
 #include "types/Waypoint.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <fmt/color.h>
 #include <fmt/core.h>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <iterator>
+#include <latch>
+#include <limits>
 #include <optional>
+#include <thread>
 using namespace RouteParser;
 
 namespace RouteHandlerTests
@@ -27,10 +42,1115 @@ namespace RouteHandlerTests
                     // fmt::print(fg(fmt::color::yellow), "[{}] {}\n", level, msg);
                     // Ignore log messages in tests
                 };
+            // Handlers share the navdata, each test starts from an empty network
+            NavdataObject::Reset();
             handler.Bootstrap(logFunc, "testdata/navdata.db", Data::SmallProceduresList, "testdata/airways.db");
         }
     };
 
+    TEST_F(RouteHandlerTest, ProcedureIndexByRunwayAndFix)
+    {
+        NavdataObject::SetProcedures(Data::ExtendedProceduresList);
+
+        auto byRunway = NavdataObject::GetProceduresByRunway("LFPG", PROCEDURE_STAR, "08R");
+        ASSERT_EQ(byRunway.size(), 3);
+        EXPECT_EQ(byRunway[0]->name, "LUKIP9ExMOPAR7E");
+        EXPECT_EQ(byRunway[1]->name, "VEDUS9ExLORNI7E");
+        EXPECT_EQ(byRunway[2]->name, "VEDUS9ExLORNI7X");
+
+        auto byFix = NavdataObject::GetProceduresByFix("LFPG", PROCEDURE_STAR, "VEDUS");
+        ASSERT_EQ(byFix.size(), 5);
+        for (const auto& procedure : byFix) {
+            EXPECT_EQ(procedure->icao, "LFPG");
+            EXPECT_EQ(procedure->type, PROCEDURE_STAR);
+        }
+
+        // Lookups hand out the loaded procedure, not a copy of it
+        auto byName = NavdataObject::GetProceduresByName("VEDUS9ExLORNI7E");
+        EXPECT_NE(std::find(byName.begin(), byName.end(), byRunway[1]), byName.end());
+
+        EXPECT_TRUE(NavdataObject::GetProceduresByFix("LFPG", PROCEDURE_SID, "VEDUS").empty());
+        EXPECT_TRUE(NavdataObject::GetProceduresByRunway("EGLL", PROCEDURE_SID, "27L").empty());
+    }
+
+    TEST_F(RouteHandlerTest, UpsertAndRemoveAirportProcedures)
+    {
+        NavdataObject::SetProcedures(Data::ExtendedProceduresList);
+        const auto names = [](const std::vector<ProcedurePtr>& procedures) {
+            std::vector<std::string> result;
+            for (const auto& procedure : procedures) {
+                result.push_back(procedure->icao + procedure->name + procedure->runway);
+            }
+            return result;
+        };
+        // Airport by airport, in the order each was first loaded
+        std::vector<std::string> airports;
+        for (const auto& procedure : Data::ExtendedProceduresList) {
+            if (std::find(airports.begin(), airports.end(), procedure.icao) == airports.end()) {
+                airports.push_back(procedure.icao);
+            }
+        }
+        std::vector<std::string> loadOrder;
+        for (const auto& icao : airports) {
+            for (const auto& procedure : Data::ExtendedProceduresList) {
+                if (procedure.icao == icao) {
+                    loadOrder.push_back(procedure.icao + procedure.name + procedure.runway);
+                }
+            }
+        }
+        EXPECT_EQ(names(NavdataObject::GetProcedures()), loadOrder);
+
+        auto lfpgBefore = NavdataObject::GetAirportProcedures("LFPG");
+        auto zsnjBefore = NavdataObject::GetAirportProcedures("ZSNJ");
+        ASSERT_NE(lfpgBefore, nullptr);
+        ASSERT_NE(zsnjBefore, nullptr);
+        auto version = NavdataObject::GetProceduresVersion();
+
+        std::vector<Procedure> lfpgUpdate;
+        for (const auto& procedure : lfpgBefore->procedures) {
+            if (procedure->runway == "08R") {
+                lfpgUpdate.push_back(*procedure);
+            }
+        }
+        NavdataObject::UpsertAirportProcedures("LFPG", lfpgUpdate);
+
+        EXPECT_GT(NavdataObject::GetProceduresVersion(), version);
+        EXPECT_EQ(NavdataObject::GetProceduresByAirport("LFPG").size(), 3);
+        EXPECT_TRUE(NavdataObject::GetProceduresByRunway("LFPG", PROCEDURE_STAR, "09L").empty());
+        EXPECT_EQ(NavdataObject::GetProceduresByName("VEDUS9ExLORNI7E").size(), 1);
+
+        // Other airports keep their chunk, old readers keep their snapshot
+        EXPECT_EQ(NavdataObject::GetAirportProcedures("ZSNJ"), zsnjBefore);
+        EXPECT_GT(lfpgBefore->procedures.size(), 3);
+
+        // The updated airport keeps its place in load order
+        std::erase_if(loadOrder, [](const std::string& key) {
+            return key.starts_with("LFPG") && !key.ends_with("08R");
+        });
+        EXPECT_EQ(names(NavdataObject::GetProcedures()), loadOrder);
+
+        NavdataObject::RemoveAirportProcedures("LFPG");
+        EXPECT_EQ(NavdataObject::GetAirportProcedures("LFPG"), nullptr);
+        std::erase_if(loadOrder, [](const std::string& key) { return key.starts_with("LFPG"); });
+        EXPECT_EQ(names(NavdataObject::GetProcedures()), loadOrder);
+        EXPECT_TRUE(NavdataObject::GetProceduresByName("VEDUS9ExLORNI7E").empty());
+        EXPECT_FALSE(NavdataObject::GetProceduresByAirport("ZSNJ").empty());
+
+        // Loaded again, it now comes last
+        NavdataObject::UpsertAirportProcedures("LFPG", lfpgUpdate);
+        for (const auto& procedure : lfpgUpdate) {
+            loadOrder.push_back(procedure.icao + procedure.name + procedure.runway);
+        }
+        EXPECT_EQ(names(NavdataObject::GetProcedures()), loadOrder);
+    }
+
+    TEST_F(RouteHandlerTest, SuggestsProceduresForActiveRunways)
+    {
+        std::unordered_map<std::string, AirportRunways> airportRunways;
+        airportRunways["ZSNJ"] = { { "06" }, {} };
+        airportRunways["VHHH"] = { {}, { "07R" } };
+        handler.GetAirportConfigurator()->UpdateAirportRunways(airportRunways);
+
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "TESIG A470 DOTMI V512 ABBEY", "ZSNJ", "VHHH");
+
+        ASSERT_TRUE(parsedRoute.suggestedSID != nullptr);
+        EXPECT_EQ(parsedRoute.suggestedSID->name, "TES61X");
+        EXPECT_EQ(parsedRoute.suggestedDepartureRunway, "06");
+        ASSERT_TRUE(parsedRoute.suggestedSTAR != nullptr);
+        EXPECT_EQ(parsedRoute.suggestedSTAR->name, "ABBEY3A");
+        EXPECT_EQ(parsedRoute.suggestedArrivalRunway, "07R");
+    }
+
+    TEST_F(RouteHandlerTest, SharedSnapshotReadersSeeWholeValues)
+    {
+        // Each value holds its own number twice, a torn or freed one would differ
+        struct Value {
+            int first;
+            int second;
+        };
+        SharedSnapshot<const Value> snapshot { std::make_shared<const Value>(Value { 0, 0 }) };
+        std::atomic<bool> writing = true;
+        std::atomic<int> torn = 0;
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; i++) {
+            readers.emplace_back([&]() {
+                int last = 0;
+                while (writing) {
+                    const auto value = snapshot.load();
+                    if (value->first != value->second || value->first < last) {
+                        torn++;
+                    }
+                    last = value->first;
+                }
+            });
+        }
+        for (int i = 1; i <= 2000; i++) {
+            snapshot = std::make_shared<const Value>(Value { i, i });
+        }
+        writing = false;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        EXPECT_EQ(torn, 0);
+        EXPECT_EQ(snapshot.load()->first, 2000);
+    }
+
+    TEST_F(RouteHandlerTest, SuggestionTablesFollowProcedureUpdates)
+    {
+        auto configurator = handler.GetAirportConfigurator();
+        std::unordered_map<std::string, AirportRunways> airportRunways;
+        airportRunways["ZSNJ"] = { { "06" }, {} };
+        configurator->UpdateAirportRunways(airportRunways);
+
+        auto suggestion = configurator->FindBestSID("ZSNJ", { "TESIG", "DOTMI" });
+        ASSERT_TRUE(suggestion.has_value());
+        ASSERT_NE(suggestion->second, nullptr);
+        EXPECT_EQ(suggestion->second->name, "TES61X");
+
+        // Without procedures the runway is still suggested
+        NavdataObject::RemoveAirportProcedures("ZSNJ");
+        suggestion = configurator->FindBestSID("ZSNJ", { "TESIG", "DOTMI" });
+        ASSERT_TRUE(suggestion.has_value());
+        EXPECT_EQ(suggestion->first, "06");
+        EXPECT_EQ(suggestion->second, nullptr);
+
+        EXPECT_FALSE(configurator->FindBestSTAR("ZSNJ", { "TESIG" }).has_value());
+
+        // Only the airport whose procedures changed is rebuilt
+        NavdataObject::SetProcedures(Data::ExtendedProceduresList);
+        airportRunways["VHHH"] = { {}, { "07R" } };
+        configurator->UpdateAirportRunways(airportRunways);
+        const auto zsnj = configurator->GetAirportSuggestions("ZSNJ");
+        const auto vhhh = configurator->GetAirportSuggestions("VHHH");
+        ASSERT_NE(vhhh, nullptr);
+        NavdataObject::UpsertAirportProcedures("ZSNJ",
+            { *NavdataObject::GetProceduresByAirport("ZSNJ").front() });
+        EXPECT_NE(configurator->GetAirportSuggestions("ZSNJ"), zsnj);
+        EXPECT_EQ(configurator->GetAirportSuggestions("VHHH"), vhhh);
+
+        // Same for runway changes
+        airportRunways["ZSNJ"] = { { "24" }, {} };
+        configurator->UpdateAirportRunways(airportRunways);
+        EXPECT_EQ(configurator->FindBestSID("ZSNJ", { "TESIG" })->first, "24");
+        EXPECT_EQ(configurator->GetAirportSuggestions("VHHH"), vhhh);
+    }
+
+    TEST_F(RouteHandlerTest, ResolverPicksShortestRouteOverGreedy)
+    {
+        auto at = [](double lat, double lon) {
+            return Waypoint(FIX, "X", "X", erkir::spherical::Point(lat, lon));
+        };
+
+        // Greedy takes the candidate of X closest to the origin, the route is
+        // shorter through the other one
+        std::vector<std::vector<Waypoint>> candidates = {
+            { at(0, -0.5), at(0, 1) },
+            { at(0, 2) },
+        };
+        auto picks = WaypointResolver::Resolve(candidates, at(0, 0), at(0, 10));
+        ASSERT_TRUE(picks.has_value());
+        EXPECT_EQ((*picks)[0], 1);
+        EXPECT_EQ((*picks)[1], 0);
+
+        // Past the bounds the caller falls back to greedy
+        candidates[0].assign(WaypointResolver::MaxCandidatesPerToken + 1, at(0, 1));
+        EXPECT_FALSE(WaypointResolver::Resolve(candidates, std::nullopt, std::nullopt));
+    }
+
+    TEST_F(RouteHandlerTest, ResolvesAmbiguousFirstWaypointFromTheRoute)
+    {
+        NavdataObject::LoadNseWaypoints(
+            { Waypoint(FIX, "AMBIG", "AMBIG", erkir::spherical::Point(-33.9, 151.2)),
+                Waypoint(FIX, "AMBIG", "AMBIG", erkir::spherical::Point(51.4, -0.2)) },
+            "resolver-test");
+
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "AMBIG TESIG A470 DOTMI", "ZSNJ", "VHHH");
+
+        ASSERT_FALSE(parsedRoute.waypoints.empty());
+        EXPECT_EQ(parsedRoute.waypoints[0].getIdentifier(), "AMBIG");
+        EXPECT_GT(parsedRoute.waypoints[0].getPosition().latitude().degrees(), 0);
+    }
+
+    TEST_F(RouteHandlerTest, AirwayExitTakesTheResolvedWaypoint)
+    {
+        // The decoy is closer to the airway entry, the real one to the rest of the route
+        const erkir::spherical::Point real(51.45, -0.05);
+        NavdataObject::LoadNseWaypoints(
+            { Waypoint(FIX, "DOTMI", "DOTMI", real),
+                Waypoint(FIX, "DOTMI", "DOTMI", erkir::spherical::Point(51.38, -0.25)) },
+            "resolver-test");
+
+        // P44 cannot be flown from TESIG, the exit is joined direct
+        const std::string route = "TESIG P44 DOTMI ABBEY";
+        auto parser = handler.GetParser();
+        auto resolved = parser->ParseRawRoute(route, "ZSNJ", "VHHH");
+        ASSERT_EQ(resolved.waypoints.size(), 3);
+        EXPECT_EQ(resolved.waypoints[1].getIdentifier(), "DOTMI");
+        EXPECT_EQ(resolved.waypoints[1].getPosition().longitude().degrees(), -0.05);
+
+        parser->SetWaypointResolution(RESOLVE_GREEDY);
+        auto greedy = parser->ParseRawRoute(route, "ZSNJ", "VHHH");
+        ASSERT_EQ(greedy.waypoints.size(), 3);
+        EXPECT_EQ(greedy.waypoints[1].getPosition().longitude().degrees(), -0.25);
+    }
+
+    TEST_F(RouteHandlerTest, ResultCacheServesRepeatedRoutes)
+    {
+        auto parser = handler.GetParser();
+        parser->EnableResultCache(8);
+
+        auto first = parser->ParseRawRouteShared("TESIG A470 DOTMI", "ZSNJ", "VHHH");
+        auto second = parser->ParseRawRouteShared("TESIG A470 DOTMI", "ZSNJ", "VHHH");
+        EXPECT_EQ(first, second);
+
+        // Same cleaned route, only the raw string is different
+        auto spaced = parser->ParseRawRouteShared("TESIG  A470 DOTMI ", "ZSNJ", "VHHH");
+        EXPECT_EQ(spaced->rawRoute, "TESIG  A470 DOTMI ");
+        EXPECT_EQ(spaced->waypoints.size(), first->waypoints.size());
+
+        // New runways change the suggestions, the cached result is not reused
+        std::unordered_map<std::string, AirportRunways> airportRunways;
+        airportRunways["ZSNJ"] = { { "06" }, {} };
+        handler.GetAirportConfigurator()->UpdateAirportRunways(airportRunways);
+        auto third = parser->ParseRawRouteShared("TESIG A470 DOTMI", "ZSNJ", "VHHH");
+        EXPECT_NE(third, first);
+        ASSERT_NE(third->suggestedSID, nullptr);
+
+        auto stats = parser->GetResultCacheStats();
+        EXPECT_EQ(stats.hits, 2);
+        EXPECT_EQ(stats.misses, 2);
+        EXPECT_EQ(stats.size, 2);
+
+        // A result of one resolution mode is never served for the other
+        ParseResultCache cache(2);
+        ParseCacheKey key { "TESIG A470 DOTMI", "ZSNJ", "VHHH", IFR, ParseOptions::Full(),
+            RESOLVE_ROUTE, 1, 1 };
+        cache.Insert(key, first);
+        key.resolution = RESOLVE_GREEDY;
+        EXPECT_EQ(cache.Find(key), nullptr);
+    }
+
+    TEST_F(RouteHandlerTest, CleanupRemovesUnknownProcedureTokens)
+    {
+        auto parser = handler.GetParser();
+        auto parsedRoute = parser->ParseRawRoute(
+            "TES61X/06 TESIG AB12C A470 DOTMI  AB12C ABBEY", "ZSNJ", "VHHH");
+        ASSERT_NE(parsedRoute.SID, nullptr);
+        const auto totalTokens = parsedRoute.totalTokens;
+
+        parser->CleanupUnrecognizedPatterns(parsedRoute, "ZSNJ", "VHHH");
+        EXPECT_EQ(parsedRoute.rawRoute, "TES61X/06 TESIG A470 DOTMI ABBEY");
+        EXPECT_EQ(parsedRoute.totalTokens, totalTokens - 2);
+        EXPECT_TRUE(std::none_of(parsedRoute.errors.begin(), parsedRoute.errors.end(),
+            [](const ParsingError& error) { return error.token == "AB12C"; }));
+    }
+
+    TEST_F(RouteHandlerTest, ReparseMatchesFullParse)
+    {
+        auto parser = handler.GetParser();
+        auto previous = parser->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+
+        for (const auto& amended : { "TES61X/06 TESIG A470 DOTMI DCT ABBEY ABBEY3A/07R",
+                 "TES61X/06 TESIG DOTMI V512 ABBEY ABBEY3A/07R",
+                 "TESIG A470 DOTMI V512 ABBEY" }) {
+            auto reparsed = parser->ReparseRawRoute(previous, amended, "ZSNJ", "VHHH");
+            auto fresh = parser->ParseRawRoute(amended, "ZSNJ", "VHHH");
+            EXPECT_EQ(nlohmann::json(reparsed), nlohmann::json(fresh)) << amended;
+        }
+    }
+
+    TEST_F(RouteHandlerTest, ReparseMatchesFullParseOfAmbiguousRoutes)
+    {
+        // DOTMI is ambiguous, its picks depend on the whole route
+        NavdataObject::LoadNseWaypoints(
+            { Waypoint(FIX, "DOTMI", "DOTMI", erkir::spherical::Point(51.45, -0.05)),
+                Waypoint(FIX, "DOTMI", "DOTMI", erkir::spherical::Point(51.38, -0.25)) },
+            "reparse-test");
+
+        auto parser = handler.GetParser();
+        for (const auto mode : { RESOLVE_ROUTE, RESOLVE_GREEDY }) {
+            parser->SetWaypointResolution(mode);
+            auto previous
+                = parser->ParseRawRoute("TESIG A470 DOTMI V512 ABBEY DOTMI", "ZSNJ", "VHHH");
+
+            // Repeated identifiers, picks moved by tokens away from the edit
+            for (const auto& amended : { "TESIG A470 DOTMI V512 ABBEY TESIG DOTMI",
+                     "DOTMI TESIG A470 DOTMI V512 ABBEY DOTMI",
+                     "TESIG A470 DOTMI DCT ABBEY DOTMI", "ABBEY DOTMI TESIG A470 DOTMI" }) {
+                auto reparsed = parser->ReparseRawRoute(previous, amended, "ZSNJ", "VHHH");
+                auto fresh = parser->ParseRawRoute(amended, "ZSNJ", "VHHH");
+                EXPECT_EQ(nlohmann::json(reparsed), nlohmann::json(fresh)) << amended;
+            }
+        }
+    }
+
+    TEST_F(RouteHandlerTest, ReparseReusesAirwayTraversals)
+    {
+        auto parser = handler.GetParser();
+        auto previous
+            = parser->ParseRawRoute("TESIG A470 DOTMI V512 ABBEY", "ZSNJ", "VHHH");
+        // Marks the traversals, only a reused one carries the mark over
+        for (auto& segment : previous.segments) {
+            ASSERT_NE(segment.airway, "DCT");
+            segment.minimumLevel = 12345;
+        }
+
+        auto reparsed = parser->ReparseRawRoute(
+            previous, "TESIG A470 DOTMI V512 ABBEY DCT TESIG", "ZSNJ", "VHHH");
+        ASSERT_EQ(reparsed.segments.size(), previous.segments.size() + 1);
+        for (const auto& segment : reparsed.segments) {
+            EXPECT_EQ(segment.minimumLevel == 12345, segment.airway != "DCT")
+                << segment.airway;
+        }
+    }
+
+    TEST_F(RouteHandlerTest, ReparseRedoesTraversalsEnteredFromAmbiguousWaypoints)
+    {
+        // V512 is entered from the DOTMI pick, which the recorded entry may not be
+        // once DOTMI is ambiguous
+        NavdataObject::LoadNseWaypoints(
+            { Waypoint(FIX, "DOTMI", "DOTMI", erkir::spherical::Point(51.45, -0.05)),
+                Waypoint(FIX, "DOTMI", "DOTMI", erkir::spherical::Point(51.38, -0.25)) },
+            "reparse-test");
+
+        auto parser = handler.GetParser();
+        auto previous = parser->ParseRawRoute("TESIG A470 DOTMI V512 ABBEY", "ZSNJ", "VHHH");
+        for (auto& segment : previous.segments) {
+            segment.minimumLevel = 12345;
+        }
+        auto reparsed
+            = parser->ReparseRawRoute(previous, "TESIG A470 DOTMI V512 ABBEY", "ZSNJ", "VHHH");
+        ASSERT_EQ(reparsed.segments.size(), previous.segments.size());
+        for (const auto& segment : reparsed.segments) {
+            EXPECT_EQ(segment.minimumLevel == 12345, segment.airway == "A470")
+                << segment.airway;
+        }
+    }
+
+    TEST_F(RouteHandlerTest, GreedyReparseReusesPicksAheadOfTheEdit)
+    {
+        auto parser = handler.GetParser();
+        parser->SetWaypointResolution(RESOLVE_GREEDY);
+        const auto network = NavdataObject::GetWaypointNetwork();
+        const std::string amended = "TESIG DOTMI ABBEY TESIG ABBEY";
+        auto previous = parser->ParseRawRoute("TESIG DOTMI ABBEY TESIG DOTMI", "ZSNJ", "VHHH");
+        ASSERT_EQ(previous.waypoints.size(), 5);
+
+        auto before = network->lookupCount();
+        auto fresh = parser->ParseRawRoute(amended, "ZSNJ", "VHHH");
+        const auto freshLookups = network->lookupCount() - before;
+
+        before = network->lookupCount();
+        auto reparsed = parser->ReparseRawRoute(previous, amended, "ZSNJ", "VHHH");
+        const auto reparseLookups = network->lookupCount() - before;
+
+        // Only the amended last token is looked up again
+        EXPECT_GE(freshLookups, 5u);
+        EXPECT_EQ(reparseLookups, 1u);
+        EXPECT_EQ(nlohmann::json(reparsed), nlohmann::json(fresh));
+
+        // Picks are only reused from the same airports
+        before = network->lookupCount();
+        parser->ReparseRawRoute(previous, amended, "ZSNJ", "ZSPD");
+        EXPECT_EQ(network->lookupCount() - before, freshLookups);
+    }
+
+    TEST_F(RouteHandlerTest, ExplicitRouteIsGeneratedOnceOnDemand)
+    {
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+        auto copy = parsedRoute;
+
+        const auto& explicitWaypoints = parsedRoute.GetExplicitWaypoints();
+        EXPECT_FALSE(explicitWaypoints.empty());
+        EXPECT_EQ(&parsedRoute.GetExplicitWaypoints(), &explicitWaypoints);
+
+        // Copied before generation and changed since, generated from its own route
+        copy.waypoints.pop_back();
+        copy.segments.pop_back();
+        EXPECT_EQ(copy.GetExplicitWaypoints().size(), explicitWaypoints.size() - 1);
+
+        // Copied after generation, the route is taken over as it is
+        auto generatedCopy = parsedRoute;
+        generatedCopy.waypoints.clear();
+        EXPECT_EQ(generatedCopy.GetExplicitWaypoints().size(), explicitWaypoints.size());
+
+        // Read back from JSON, the explicit route is taken as serialised
+        nlohmann::json serialised = parsedRoute;
+        auto restored = serialised.get<ParsedRoute>();
+        EXPECT_EQ(nlohmann::json(restored), serialised);
+    }
+
+    TEST_F(RouteHandlerTest, ParseOptionsSkipStages)
+    {
+        const std::string route = "TESIG/N0450F350 A470 DOTMI UNKWN";
+        auto parser = handler.GetParser();
+        auto full = parser->ParseRawRoute(route, "ZSNJ", "VHHH");
+        ASSERT_FALSE(full.segments.empty());
+        ASSERT_TRUE(full.waypoints[0].GetPlannedPosition().has_value());
+        ASSERT_FALSE(full.errors.empty());
+
+        // Same errors, no geometry extras
+        auto validation
+            = parser->ParseRawRoute(route, "ZSNJ", "VHHH", IFR, ParseOptions::ValidationOnly());
+        ASSERT_EQ(validation.errors.size(), full.errors.size());
+        EXPECT_EQ(validation.errors[0].GetMessage(), full.errors[0].GetMessage());
+        EXPECT_EQ(validation.waypoints.size(), full.waypoints.size());
+        EXPECT_TRUE(validation.GetExplicitWaypoints().empty());
+        for (const auto& segment : validation.segments) {
+            EXPECT_EQ(segment.heading, 0);
+        }
+
+        // Same geometry, no messages or planned positions
+        auto display
+            = parser->ParseRawRoute(route, "ZSNJ", "VHHH", IFR, ParseOptions::DisplayOnly());
+        ASSERT_EQ(display.errors.size(), full.errors.size());
+        EXPECT_EQ(display.errors[0].type, full.errors[0].type);
+        EXPECT_TRUE(display.errors[0].GetMessage().empty());
+        EXPECT_FALSE(display.waypoints[0].GetPlannedPosition().has_value());
+        ASSERT_EQ(display.segments.size(), full.segments.size());
+        EXPECT_EQ(display.segments[0].heading, full.segments[0].heading);
+    }
+
+    TEST_F(RouteHandlerTest, CompactRouteKeepsJson)
+    {
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+        ASSERT_FALSE(parsedRoute.segments.empty());
+
+        auto compact = CompactParsedRoute::FromParsedRoute(parsedRoute);
+        EXPECT_EQ(nlohmann::json(compact), nlohmann::json(parsedRoute));
+        EXPECT_EQ(nlohmann::json(compact.ToParsedRoute()), nlohmann::json(parsedRoute));
+
+        // Segment ends are the route waypoints, stored once
+        EXPECT_LT(compact.waypointPool.size(),
+            parsedRoute.waypoints.size() + 2 * parsedRoute.segments.size());
+        EXPECT_EQ(compact.GetWaypoint(compact.segments[0].to).getIdentifier(),
+            parsedRoute.segments[0].to.getIdentifier());
+    }
+
+    TEST_F(RouteHandlerTest, ErrorCollectorDeduplicates)
+    {
+        ParsingErrorCollector errors;
+        EXPECT_TRUE(errors.InsertIfNotDuplicate(
+            { UNKNOWN_WAYPOINT, MESSAGE_UNKNOWN_WAYPOINT, {}, 1, "XXXXX", PARSE_ERROR }));
+        EXPECT_FALSE(errors.InsertIfNotDuplicate(
+            { UNKNOWN_WAYPOINT, MESSAGE_UNKNOWN_WAYPOINT, {}, 1, "XXXXX", PARSE_ERROR }));
+        // Same key, different message
+        EXPECT_TRUE(errors.InsertIfNotDuplicate(
+            { UNKNOWN_WAYPOINT, MESSAGE_TEXT, { "Other message" }, 1, "XXXXX", PARSE_ERROR }));
+        EXPECT_TRUE(errors.InsertIfNotDuplicate(
+            { UNKNOWN_WAYPOINT, MESSAGE_UNKNOWN_WAYPOINT, {}, 2, "XXXXX", PARSE_ERROR }));
+        errors.push_back({ INVALID_DATA, MESSAGE_TEXT, { "Invalid data" }, 3, "YYYYY", PARSE_ERROR });
+        ASSERT_EQ(errors.size(), 4);
+
+        EXPECT_EQ(errors.RemoveToken("XXXXX"), 3);
+        ASSERT_EQ(errors.size(), 1);
+        EXPECT_EQ(errors[0].token, "YYYYY");
+        EXPECT_TRUE(errors.InsertIfNotDuplicate(
+            { UNKNOWN_WAYPOINT, MESSAGE_UNKNOWN_WAYPOINT, {}, 1, "XXXXX", PARSE_ERROR }));
+        EXPECT_FALSE(errors.InsertIfNotDuplicate(
+            { INVALID_DATA, MESSAGE_TEXT, { "Invalid data" }, 3, "YYYYY", PARSE_ERROR }));
+    }
+
+    TEST_F(RouteHandlerTest, ErrorMessagesAreRenderedOnRead)
+    {
+        const ParsingError error { INSUFFICIENT_FLIGHT_LEVEL, MESSAGE_AIRWAY_REQUIRED_LEVEL,
+            { ParsingErrorArgument(245) }, 2, "A470", PARSE_ERROR };
+        EXPECT_EQ(error.GetMessage(), "Required FL245");
+
+        const ParsingError direction { INVALID_AIRWAY_DIRECTION, MESSAGE_AIRWAY_DIRECTION,
+            { "A470", "DOTMI", "TESIG" }, 2, "A470", PARSE_ERROR };
+        nlohmann::json serialised = direction;
+        EXPECT_EQ(serialised["message"], "Cannot traverse airway A470 from DOTMI to TESIG");
+
+        // Read back as text, same JSON
+        EXPECT_EQ(nlohmann::json(serialised.get<ParsingError>()), serialised);
+    }
+
+    TEST_F(RouteHandlerTest, JsonWriterMatchesNlohmann)
+    {
+        ActivateSampleRunways(handler);
+
+        std::string buffer;
+        for (const auto& route : { "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R",
+                 "TESIG A470 DOTMI 5220N03305E/M082F350 XXXXX", "" }) {
+            auto parsedRoute = handler.GetParser()->ParseRawRoute(route, "ZSNJ", "VHHH");
+            buffer.clear();
+            WriteParsedRouteJson(parsedRoute, buffer);
+            EXPECT_EQ(buffer, nlohmann::json(parsedRoute).dump()) << route;
+        }
+
+        // Escaping and number formatting
+        ParsedRoute parsedRoute;
+        parsedRoute.rawRoute = "\"quoted\" \\ \t\n\x01 \xc3\xa9";
+        parsedRoute.waypoints.emplace_back(
+            FIX, "FIX", erkir::spherical::Point(1e-7, 0.1 + 0.2), 0, VFR);
+        parsedRoute.waypoints.emplace_back(FIX, "ZERO", erkir::spherical::Point(-0.0, 180.0));
+        buffer.clear();
+        WriteParsedRouteJson(parsedRoute, buffer);
+        EXPECT_EQ(buffer, nlohmann::json(parsedRoute).dump());
+    }
+
+    // Equal JSON, numbers within the coordinate quantisation of the codec
+    bool SameJsonQuantised(const nlohmann::json& a, const nlohmann::json& b)
+    {
+        if (a.is_number_float() && b.is_number_float()) {
+            return std::abs(a.get<double>() - b.get<double>()) <= 0.5e-7 + 1e-12;
+        }
+        if (a.type() != b.type() || a.size() != b.size()) {
+            return false;
+        }
+        if (a.is_object()) {
+            for (auto it = a.begin(); it != a.end(); ++it) {
+                if (!b.contains(it.key()) || !SameJsonQuantised(it.value(), b[it.key()])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (a.is_array()) {
+            for (size_t i = 0; i < a.size(); i++) {
+                if (!SameJsonQuantised(a[i], b[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return a == b;
+    }
+
+    TEST_F(RouteHandlerTest, RouteCodecRoundTrip)
+    {
+        ActivateSampleRunways(handler);
+
+        for (const auto& route : { "TES61X/06 TESIG/N0450F350 A470 DOTMI V512 ABBEY ABBEY3A/07R",
+                 "TESIG A470 DOTMI 5220N03305E/M082F350 XXXXX", "" }) {
+            auto parsedRoute = handler.GetParser()->ParseRawRoute(route, "ZSNJ", "VHHH");
+            std::string encoded;
+            EncodeParsedRoute(parsedRoute, encoded);
+
+            const auto decoded = DecodeParsedRoute(encoded);
+            EXPECT_TRUE(SameJsonQuantised(nlohmann::json(decoded), nlohmann::json(parsedRoute)))
+                << route;
+            EXPECT_LT(encoded.size(), nlohmann::json(parsedRoute).dump().size() / 4) << route;
+
+            // Quantised coordinates encode to the same bytes again
+            std::string reencoded;
+            EncodeParsedRoute(decoded, reencoded);
+            EXPECT_EQ(reencoded, encoded) << route;
+        }
+
+        std::string encoded;
+        EncodeParsedRoute(handler.GetParser()->ParseRawRoute("TESIG A470 DOTMI", "ZSNJ", "VHHH"),
+            encoded);
+        EXPECT_THROW(DecodeParsedRoute(encoded.substr(0, encoded.size() - 1)), RouteDecodeException);
+        EXPECT_THROW(DecodeParsedRoute(encoded + "x"), RouteDecodeException);
+        EXPECT_THROW(DecodeParsedRoute("{}"), RouteDecodeException);
+    }
+
+    TEST_F(RouteHandlerTest, RouteCodecRejectsOutOfRangeValues)
+    {
+        // Well-formed streams carrying values no parse result has
+        auto roundTrip = [](auto encode, auto decode) {
+            RouteCodec::Encoder encoder;
+            encode(encoder);
+            std::string encoded;
+            encoder.Finish(encoded);
+            RouteCodec::Decoder decoder(encoded);
+            return decode(decoder);
+        };
+        auto errorRoundTrip = [&](const ParsingError& error) {
+            return roundTrip([&](RouteCodec::Encoder& encoder) { encoder.Error(error); },
+                [](RouteCodec::Decoder& decoder) { return decoder.Error(); });
+        };
+
+        const ParsingError valid { INVALID_AIRWAY_DIRECTION, MESSAGE_AIRWAY_DIRECTION,
+            { "A470", "DOTMI", "TESIG" }, 1, "A470", PARSE_ERROR };
+        EXPECT_EQ(errorRoundTrip(valid).GetMessage(), valid.GetMessage());
+
+        auto corrupt = valid;
+        corrupt.type = static_cast<ParsingErrorType>(MULTIPLE_AIRWAYS_FOUND + 1);
+        EXPECT_THROW(errorRoundTrip(corrupt), RouteDecodeException);
+        corrupt = valid;
+        corrupt.level = static_cast<ParsingErrorLevel>(PARSE_ERROR + 1);
+        EXPECT_THROW(errorRoundTrip(corrupt), RouteDecodeException);
+        corrupt = valid;
+        corrupt.messageCode = static_cast<ParsingErrorMessage>(MESSAGE_RUNWAY_NOT_FOUND + 1);
+        EXPECT_THROW(errorRoundTrip(corrupt), RouteDecodeException);
+        // Fewer arguments than the message format takes
+        corrupt = valid;
+        corrupt.arguments.pop_back();
+        EXPECT_THROW(errorRoundTrip(corrupt), RouteDecodeException);
+
+        const RouteWaypoint waypoint(FIX, "TESIG", erkir::spherical::Point(51.38, -0.15), 0,
+            IFR,
+            RouteWaypoint::PlannedAltitudeAndSpeed {
+                35000, 450, static_cast<Units::Distance>(Units::Distance::METERS + 1) });
+        EXPECT_THROW(
+            roundTrip([&](RouteCodec::Encoder& encoder) { encoder.PoolWaypoint(waypoint); },
+                [](RouteCodec::Decoder& decoder) { return decoder.PoolWaypoint(); }),
+            RouteDecodeException);
+
+        // Coordinate deltas that overflow or leave the globe
+        auto positionRoundTrip = [&](int64_t latitudeDelta, int64_t longitudeDelta) {
+            return roundTrip(
+                [&](RouteCodec::Encoder& encoder) {
+                    encoder.Position(erkir::spherical::Point(89, 179));
+                    encoder.Signed(latitudeDelta);
+                    encoder.Signed(longitudeDelta);
+                },
+                [](RouteCodec::Decoder& decoder) {
+                    decoder.Position();
+                    return decoder.Position();
+                });
+        };
+        EXPECT_NEAR(positionRoundTrip(-10'000'000, -10'000'000).latitude().degrees(), 88, 1e-9);
+        EXPECT_THROW(positionRoundTrip(std::numeric_limits<int64_t>::max(), 0),
+            RouteDecodeException);
+        EXPECT_THROW(positionRoundTrip(0, std::numeric_limits<int64_t>::min()),
+            RouteDecodeException);
+        EXPECT_THROW(positionRoundTrip(20'000'000, 0), RouteDecodeException);
+        EXPECT_THROW(positionRoundTrip(0, 20'000'000), RouteDecodeException);
+    }
+
+    TEST_F(RouteHandlerTest, ExplicitRoutePolyline)
+    {
+        // Reference example of the format
+        std::string encoded;
+        Polyline polyline(encoded);
+        polyline.Add(erkir::spherical::Point(38.5, -120.2));
+        polyline.Add(erkir::spherical::Point(40.7, -120.95));
+        polyline.Add(erkir::spherical::Point(43.252, -126.453));
+        EXPECT_EQ(encoded, "_p~iF~ps|U_ulLnnqC_mqNvxq`@");
+
+        const auto points = Polyline::Decode(encoded);
+        ASSERT_EQ(points.size(), 3);
+        EXPECT_DOUBLE_EQ(points[2].latitude().degrees(), 43.252);
+        EXPECT_DOUBLE_EQ(points[2].longitude().degrees(), -126.453);
+        EXPECT_THROW(Polyline::Decode("_p~iF~ps|"), std::invalid_argument);
+        EXPECT_THROW(Polyline::Decode(encoded, -1), std::invalid_argument);
+        EXPECT_THROW(
+            Polyline::Decode(encoded, Polyline::MaxPrecision + 1), std::invalid_argument);
+        EXPECT_THROW(Polyline rejected(encoded, 400), std::invalid_argument);
+        // Latitude 38.5 read with 1 decimal is 3850 degrees
+        EXPECT_THROW(Polyline::Decode(encoded, 1), std::invalid_argument);
+        // A delta of 60 bits, then two of 50 degrees north
+        EXPECT_THROW(Polyline::Decode("~~~~~~~~~~~~??"), std::invalid_argument);
+        EXPECT_THROW(Polyline::Decode("_sdpH?_sdpH?"), std::invalid_argument);
+
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+        const auto& waypoints = parsedRoute.GetExplicitWaypoints();
+        ASSERT_FALSE(waypoints.empty());
+        const auto decoded = Polyline::Decode(parsedRoute.GetExplicitPolyline(6), 6);
+        ASSERT_EQ(decoded.size(), waypoints.size());
+        for (size_t i = 0; i < decoded.size(); i++) {
+            EXPECT_NEAR(decoded[i].latitude().degrees(),
+                waypoints[i].getPosition().latitude().degrees(), 0.5e-6);
+            EXPECT_NEAR(decoded[i].longitude().degrees(),
+                waypoints[i].getPosition().longitude().degrees(), 0.5e-6);
+        }
+    }
+
+    TEST_F(RouteHandlerTest, RouteRingSharesRoutes)
+    {
+        // Unique, test runs may overlap
+        const auto path = TemporaryPathFor(
+            (std::filesystem::temp_directory_path() / "routeparser_ring_test.bin").string());
+        RouteRingWriter writer(path, 4, 1024);
+        ASSERT_TRUE(writer.IsOpen());
+        RouteRingReader reader(path);
+        ASSERT_TRUE(reader.IsOpen());
+        EXPECT_FALSE(reader.Read(0));
+
+        auto parsedRoute = handler.GetParser()->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+        for (int i = 0; i < 6; i++) {
+            parsedRoute.totalTokens = i;
+            ASSERT_TRUE(writer.Publish(parsedRoute));
+        }
+        EXPECT_EQ(reader.Published(), 6);
+        EXPECT_EQ(reader.Oldest(), 2);
+        // Overwritten
+        EXPECT_FALSE(reader.Read(1));
+        auto route = reader.Read(5);
+        ASSERT_TRUE(route);
+        EXPECT_EQ(route->totalTokens, 5);
+        EXPECT_TRUE(SameJsonQuantised(nlohmann::json(*route), nlohmann::json(parsedRoute)));
+
+        // A consistent slot holding garbage is not available either
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(RouteRingLayout::HeaderSize + 1 * 1024 + sizeof(RouteRingLayout::Slot)
+                + RouteCodec::Magic.size() + 1);
+            file.write(std::string(64, '\xFF').data(), 64);
+        }
+        EXPECT_FALSE(reader.Read(5));
+        EXPECT_TRUE(reader.Read(4));
+
+        // Too large for a slot
+        parsedRoute.rawRoute = std::string(2000, 'X');
+        EXPECT_FALSE(writer.Publish(parsedRoute));
+        EXPECT_EQ(reader.Published(), 6);
+
+        // Readers only ever see complete routes while the writer laps them
+        parsedRoute.rawRoute = "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R";
+        std::thread publisher([&]() {
+            for (int i = 6; i < 2000; i++) {
+                parsedRoute.totalTokens = i;
+                writer.Publish(parsedRoute);
+            }
+        });
+        while (reader.Published() < 2000) {
+            const auto number = reader.Published() - 1;
+            if (auto latest = reader.Read(number)) {
+                EXPECT_EQ(latest->totalTokens, number);
+                EXPECT_EQ(latest->rawRoute, "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R");
+            }
+        }
+        publisher.join();
+        ASSERT_TRUE(reader.Read(1999));
+        EXPECT_EQ(reader.Read(1999)->totalTokens, 1999);
+
+        // A new ring replaces the file, attached readers keep the previous one
+        RouteRingWriter replacement(path, 8, 512);
+        ASSERT_TRUE(replacement.IsOpen());
+        EXPECT_EQ(reader.Published(), 2000);
+        EXPECT_TRUE(reader.Read(1999));
+        EXPECT_EQ(RouteRingReader(path).Published(), 0);
+
+        // Slots that could not hold a slot header
+        const auto invalidPath = TemporaryPathFor(path);
+        {
+            RouteRingLayout::Header header {};
+            std::memcpy(header.magic, RouteRingLayout::Magic, sizeof(RouteRingLayout::Magic));
+            header.slotCount = 4;
+            header.slotSize = 8;
+            std::ofstream file(invalidPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(std::string(RouteRingLayout::FileSize(4, 1024), '\0').data(),
+                RouteRingLayout::FileSize(4, 1024));
+        }
+        EXPECT_FALSE(RouteRingReader(invalidPath).IsOpen());
+        std::filesystem::remove(invalidPath);
+        std::filesystem::remove(path);
+    }
+
+    TEST_F(RouteHandlerTest, NavdataImageMatchesDatabase)
+    {
+        // Unique, test runs may overlap
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto imagePath
+            = TemporaryPathFor((directory / "routeparser_airways_test.img").string());
+        ASSERT_TRUE(NavdataImage::BuildFromDatabase("testdata/airways.db", imagePath, true));
+
+        AirwayWaypointProvider database("testdata/airways.db", "Airways DB");
+        MappedWaypointProvider image(imagePath, "Airways image");
+        ASSERT_TRUE(database.initialize());
+        ASSERT_TRUE(image.initialize());
+        WaypointProvider& expected = database;
+        WaypointProvider& mapped = image;
+        for (const std::string identifier : { "TESIG", "DOTMI", "ABBEY", "XXXXX" }) {
+            const auto expectedWaypoints = expected.findWaypoint(identifier);
+            const auto mappedWaypoints = mapped.findWaypoint(identifier);
+            ASSERT_EQ(mappedWaypoints.size(), expectedWaypoints.size()) << identifier;
+            for (size_t i = 0; i < mappedWaypoints.size(); i++) {
+                EXPECT_EQ(nlohmann::json(mappedWaypoints[i]), nlohmann::json(expectedWaypoints[i]));
+            }
+        }
+
+        // Duplicate identifiers keep their order and own names
+        const auto ownPath
+            = TemporaryPathFor((directory / "routeparser_own_test.img").string());
+        ASSERT_TRUE(NavdataImage::Build(
+            { Waypoint(VOR, "ABC", "ABC NORTH", erkir::spherical::Point(10.0, 20.0), 113000000),
+                Waypoint(FIX, "AAA", "AAA", erkir::spherical::Point(1.0, 2.0)),
+                Waypoint(NDB, "ABC", "ABC SOUTH", erkir::spherical::Point(-10.0, 20.0), 350000) },
+            ownPath));
+        MappedWaypointProvider own(ownPath, "Own image");
+        ASSERT_TRUE(own.initialize());
+        const auto abc = own.findWaypoint("ABC");
+        ASSERT_EQ(abc.size(), 2);
+        EXPECT_EQ(abc[0].getName(), "ABC NORTH");
+        EXPECT_EQ(abc[1].getFrequencyHz(), 350000);
+        EXPECT_EQ(own.findClosestWaypoint("ABC", erkir::spherical::Point(-9.0, 20.0))->getName(),
+            "ABC SOUTH");
+        EXPECT_EQ(own.findWaypoint("AAA").size(), 1);
+        EXPECT_TRUE(own.findWaypoint("AB").empty());
+
+        // Offsets that wrap around or are misaligned
+        std::string bytes;
+        {
+            std::ifstream file(ownPath, std::ios::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), {});
+        }
+        ASSERT_GT(bytes.size(), sizeof(NavdataImage::Header));
+        for (const auto waypointsOffset : { ~uint64_t { 0 } - 8, uint64_t { 52 } }) {
+            NavdataImage::Header header;
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            header.waypointsOffset = waypointsOffset;
+            auto patched = bytes;
+            std::memcpy(patched.data(), &header, sizeof(header));
+            std::ofstream(ownPath, std::ios::binary | std::ios::trunc) << patched;
+            MappedWaypointProvider invalid(ownPath, "Invalid image");
+            EXPECT_FALSE(invalid.initialize()) << waypointsOffset;
+        }
+
+        // Not an image
+        std::ofstream(ownPath, std::ios::trunc) << "garbage that is not an image at all, really";
+        MappedWaypointProvider corrupt(ownPath, "Corrupt image");
+        EXPECT_FALSE(corrupt.initialize());
+
+        std::filesystem::remove(imagePath);
+        std::filesystem::remove(ownPath);
+    }
+
+    TEST_F(RouteHandlerTest, BootstrapModesLoadSameNavdata)
+    {
+        const auto route = "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R";
+        const auto expected
+            = nlohmann::json(handler.GetParser()->ParseRawRoute(route, "ZSNJ", "VHHH")).dump();
+        EXPECT_TRUE(handler.IsReady());
+
+        for (const auto mode : { BootstrapMode::Parallel, BootstrapMode::Lazy }) {
+            // A new handler keeps the network the others are using
+            const auto network = NavdataObject::GetWaypointNetwork();
+            RouteHandler other;
+            EXPECT_EQ(NavdataObject::GetWaypointNetwork(), network);
+            EXPECT_FALSE(other.IsReady());
+            NavdataObject::Reset();
+            other.Bootstrap([](const char*, const char*) {}, "testdata/navdata.db",
+                Data::SmallProceduresList, "testdata/airways.db", { mode });
+            EXPECT_TRUE(other.IsReady());
+            // Any thread may wait for the background loaders
+            std::thread waiter([&other]() { other.WaitUntilLoaded(); });
+            other.WaitUntilLoaded();
+            waiter.join();
+            EXPECT_EQ(
+                nlohmann::json(other.GetParser()->ParseRawRoute(route, "ZSNJ", "VHHH")).dump(),
+                expected);
+        }
+    }
+
+    TEST_F(RouteHandlerTest, BootstrapReportCoversLoadersAndMemory)
+    {
+        RouteHandler other;
+        other.Bootstrap([](const char*, const char*) {}, "testdata/navdata.db",
+            Data::SmallProceduresList, "testdata/airways.db", { BootstrapMode::Parallel });
+        other.GetParser()->ParseRawRoute(
+            "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R", "ZSNJ", "VHHH");
+        // Rows are counted in the background
+        other.WaitUntilLoaded();
+
+        const auto report = other.GetBootstrapReport();
+        EXPECT_EQ(report.mode, BootstrapMode::Parallel);
+        ASSERT_EQ(report.loaders.size(), 5u);
+        EXPECT_EQ(report.loaders[0].name, "procedures");
+        EXPECT_EQ(report.loaders[0].rows, Data::SmallProceduresList.size());
+        EXPECT_EQ(report.loaders[1].name, "airways");
+        EXPECT_GT(report.loaders[1].rows, 0u);
+        EXPECT_GT(report.loaders[1].milliseconds, 0.0);
+        EXPECT_GE(report.totalMilliseconds, report.loaders[1].milliseconds);
+        // Parallel returns once everything is loaded
+        EXPECT_LE(report.totalMilliseconds, report.readyMilliseconds);
+
+        const auto entry = [&report](const std::string& name) {
+            auto it = std::find_if(report.memory.begin(), report.memory.end(),
+                [&name](const MemoryUsageEntry& usage) { return usage.name == name; });
+            return it != report.memory.end() ? *it : MemoryUsageEntry {};
+        };
+        EXPECT_EQ(entry("procedures").entries, Data::SmallProceduresList.size());
+        EXPECT_GT(entry("procedures").bytes, 0u);
+        EXPECT_GT(entry("procedure indices").bytes, 0u);
+        EXPECT_GT(entry("waypoint cache").entries, 0u);
+        EXPECT_EQ(entry("airport cache").name, "airport cache");
+        EXPECT_EQ(entry("runway cache").name, "runway cache");
+        EXPECT_GT(report.TotalBytes(), entry("procedures").bytes);
+        EXPECT_EQ(nlohmann::json(report)["mode"], "parallel");
+    }
+
+    TEST_F(RouteHandlerTest, PrefetchedParseMatchesSequential)
+    {
+        const auto route = "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R";
+        auto parser = handler.GetParser();
+        NavdataObject::GetWaypointNetwork()->clearCache();
+        const auto expected = nlohmann::json(parser->ParseRawRoute(route, "ZSNJ", "VHHH")).dump();
+
+        parser->EnablePrefetch(2);
+        for (int i = 0; i < 20; i++) {
+            NavdataObject::GetWaypointNetwork()->clearCache();
+            EXPECT_EQ(nlohmann::json(parser->ParseRawRoute(route, "ZSNJ", "VHHH")).dump(),
+                expected);
+        }
+        parser->EnablePrefetch(0);
+    }
+
+    TEST_F(RouteHandlerTest, ConcurrentLookupsMatchSequential)
+    {
+        const auto route = "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R";
+        auto parser = handler.GetParser();
+        NavdataObject::GetWaypointNetwork()->clearCache();
+        const auto expected = nlohmann::json(parser->ParseRawRoute(route, "ZSNJ", "VHHH")).dump();
+
+        // Cold parses at once, each lookup leases its own connection
+        for (int round = 0; round < 5; round++) {
+            NavdataObject::GetWaypointNetwork()->clearCache();
+            std::vector<std::thread> parses;
+            std::atomic<int> differing = 0;
+            for (int i = 0; i < 4; i++) {
+                parses.emplace_back([&]() {
+                    if (nlohmann::json(parser->ParseRawRoute(route, "ZSNJ", "VHHH")).dump()
+                        != expected) {
+                        differing++;
+                    }
+                });
+            }
+            for (auto& parse : parses) {
+                parse.join();
+            }
+            EXPECT_EQ(differing, 0);
+        }
+
+        // Concurrent misses of one identifier cache it once: the provider holds every
+        // lookup until all of them missed the cache
+        struct GatedProvider : WaypointProvider {
+            std::latch& gate;
+            explicit GatedProvider(std::latch& gate)
+                : gate(gate)
+            {
+            }
+            std::vector<Waypoint> findWaypoint(const std::string& identifier) override
+            {
+                gate.arrive_and_wait();
+                return { Waypoint(FIX, identifier, identifier, erkir::spherical::Point(1.0, 2.0)) };
+            }
+            std::optional<Waypoint> findClosestWaypoint(
+                const std::string&, const erkir::spherical::Point&) override
+            {
+                return std::nullopt;
+            }
+            bool initialize() override { return true; }
+            bool isInitialized() const override { return true; }
+            std::string getName() const override { return "Gated"; }
+            int getPriority() const override { return 0; }
+        };
+        const int threadCount = 8;
+        std::latch gate(threadCount);
+        WaypointNetwork network;
+        ASSERT_TRUE(network.addProvider(std::make_unique<GatedProvider>(gate)));
+        std::vector<std::thread> lookups;
+        std::atomic<int> mismatches = 0;
+        for (int i = 0; i < threadCount; i++) {
+            lookups.emplace_back([&]() {
+                if (network.findWaypoint("GATED").size() != 1) {
+                    mismatches++;
+                }
+            });
+        }
+        for (auto& lookup : lookups) {
+            lookup.join();
+        }
+        EXPECT_EQ(mismatches, 0);
+        EXPECT_EQ(network.memoryUsage()[0].entries, 1u);
+        EXPECT_EQ(network.findWaypoint("GATED").size(), 1u);
+
+        const auto usage = NavdataObject::MemoryUsage();
+        auto airways = std::find_if(usage.begin(), usage.end(),
+            [](const MemoryUsageEntry& entry) { return entry.name == "airway cache"; });
+        ASSERT_NE(airways, usage.end());
+        EXPECT_GT(airways->entries, 0u);
+    }
+
+    TEST_F(RouteHandlerTest, AsyncParseRunsOnTheExecutor)
+    {
+        // Runs the work inline, counting what was handed to it
+        struct CountingExecutor : Executor {
+            int posted = 0;
+            void Post(std::function<void()> work) override
+            {
+                posted++;
+                work();
+            }
+        };
+
+        const std::string route = "TES61X/06 TESIG A470 DOTMI V512 ABBEY ABBEY3A/07R";
+        auto parser = handler.GetParser();
+        const auto expected = nlohmann::json(parser->ParseRawRoute(route, "ZSNJ", "VHHH")).dump();
+
+        ThreadPoolExecutor pool(2);
+        const auto caller = std::this_thread::get_id();
+        auto parseOnPool = [&]() -> Task<std::thread::id> {
+            auto parsed = co_await parser->ParseRawRouteAsync(pool, route, "ZSNJ", "VHHH");
+            EXPECT_EQ(nlohmann::json(parsed).dump(), expected);
+            co_return std::this_thread::get_id();
+        };
+        EXPECT_NE(SyncWait(parseOnPool()), caller);
+
+        // Cache hits complete without going through the executor
+        CountingExecutor counting;
+        parser->EnableResultCache(8);
+        SyncWait(parser->ParseRawRouteAsync(counting, route, "ZSNJ", "VHHH"));
+        auto cached = SyncWait(parser->ParseRawRouteAsync(counting, route, "ZSNJ", "VHHH"));
+        EXPECT_EQ(counting.posted, 1);
+        EXPECT_EQ(nlohmann::json(cached).dump(), expected);
+        EXPECT_EQ(parser->GetResultCacheStats().misses, 1u);
+
+        // Exceptions reach the awaiting side
+        auto failing = []() -> Task<int> {
+            throw std::runtime_error("failed");
+            co_return 0;
+        };
+        EXPECT_THROW(SyncWait(failing()), std::runtime_error);
+    }
+
+    TEST_F(RouteHandlerTest, WarmStartPrefetchesSavedKeys)
+    {
+        // Unique, test runs may overlap
+        const auto path = TemporaryPathFor(
+            (std::filesystem::temp_directory_path() / "route-parser-warm-start-test.json")
+                .string());
+        BootstrapOptions options;
+        options.warmStartFile = path;
+
+        {
+            RouteHandler first;
+            first.Bootstrap([](const char*, const char*) {}, "testdata/navdata.db",
+                Data::SmallProceduresList, "testdata/airways.db", options);
+            first.GetParser()->ParseRawRoute("TESIG A470 DOTMI", "ZSNJ", "VHHH");
+            EXPECT_TRUE(first.SaveWarmStart());
+        }
+        // Saved again on destruction
+        const auto saved = WarmStart::Load(path);
+        ASSERT_TRUE(saved.has_value());
+        EXPECT_NE(std::find(saved->waypoints.begin(), saved->waypoints.end(), "DOTMI"),
+            saved->waypoints.end());
+
+        NavdataObject::GetWaypointNetwork()->clearCache();
+        options.mode = BootstrapMode::Lazy;
+        {
+            RouteHandler second;
+            second.Bootstrap([](const char*, const char*) {}, "testdata/navdata.db",
+                Data::SmallProceduresList, "testdata/airways.db", options);
+            second.WaitUntilLoaded();
+            const auto prefetched = NavdataObject::GetWaypointNetwork()->cachedKeys();
+            for (const auto& identifier : saved->waypoints) {
+                EXPECT_NE(std::find(prefetched.begin(), prefetched.end(), identifier),
+                    prefetched.end())
+                    << identifier;
+            }
+        }
+
+        // A missing or broken file only skips the prefetch
+        std::ofstream(path, std::ios::trunc) << "{ not json";
+        EXPECT_FALSE(WarmStart::Load(path).has_value());
+        std::filesystem::remove(path);
+        EXPECT_FALSE(WarmStart::Load(path).has_value());
+    }
+
 //    TEST_F(RouteHandlerTest, EmptyRoute)
 //    {
 //        auto parsedRoute = handler.GetParser()->ParseRawRoute("", "KSFO", "KLAX");
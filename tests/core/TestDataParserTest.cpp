@@ -128,6 +128,7 @@ protected:
             // Initialize the NavdataObject and load the NSE waypoints before
             // bootstrapping
             auto navdata = std::make_shared<RouteParser::NavdataObject>();
+            NavdataObject::Reset();
 
             // Load NSE waypoints
             NavdataObject::LoadNseWaypoints(Data::NseWaypointsList, "Test NSE Provider");
@@ -162,7 +163,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
         "LPPR");
 
     std::cout << "Route: " << parsedRoute.rawRoute << std::endl;
-    if (parsedRoute.suggestedSID.has_value()) {
+    if (parsedRoute.suggestedSID != nullptr) {
         std::cout << "Suggested SID: " << parsedRoute.suggestedSID->name
             << " for runway " << parsedRoute.suggestedDepartureRunway.value_or("NONE")
             << std::endl;
@@ -175,7 +176,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
         }
     }
 
-    if (parsedRoute.SID.has_value()) {
+    if (parsedRoute.SID != nullptr) {
         std::cout << "Actual SID: " << parsedRoute.SID->name
             << " for runway " << parsedRoute.departureRunway.value_or("NONE")
             << std::endl;
@@ -189,7 +190,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //     "PO6B/26R PG822 DCT QXCEL DCT PG824 DCT PG825 DCT 4837N00249E 4844N00251E DCT", "LFPG", "LFPO");
 //
 //     std::cout << "Route: " << parsedRoute.rawRoute << std::endl;
-//     if (parsedRoute.suggestedSID.has_value()) {
+//     if (parsedRoute.suggestedSID != nullptr) {
 //         std::cout << "Suggested SID: " << parsedRoute.suggestedSID->name
 //             << " for runway " << parsedRoute.suggestedDepartureRunway.value_or("NONE")
 //             << std::endl;
@@ -197,7 +198,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //     }
 //
 //
-//     if (parsedRoute.SID.has_value()) {
+//     if (parsedRoute.SID != nullptr) {
 //         std::cout << "Actual SID: " << parsedRoute.SID->name
 //             << " for runway " << parsedRoute.departureRunway.value_or("NONE") <<
 //             std::endl;
@@ -212,7 +213,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //     "LATRA DCT LAMUT DCT UTUVA/N0447F370 DCT TITVA DCT NOQAS UM728 KOLON DCT LOKDU DCT PELOS DCT IPROM DCT MOROB DCT GIGGI DCT CAR DCT NOLSI/N0416F230 A868 MEDAR", "LFPG", "EDDM");
 //     std::cout << "Route: " << parsedRoute.rawRoute << std::endl;
 //
-//     if (parsedRoute.suggestedSID.has_value()) {
+//     if (parsedRoute.suggestedSID != nullptr) {
 //         std::cout << "Suggested SID: " << parsedRoute.suggestedSID->name
 //             << " for runway " << parsedRoute.suggestedDepartureRunway.value_or("NONE")
 //             << std::endl;
@@ -220,7 +221,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //     }
 //
 //
-//     if (parsedRoute.SID.has_value()) {
+//     if (parsedRoute.SID != nullptr) {
 //         std::cout << "Actual SID: " << parsedRoute.SID->name
 //             << " for runway " << parsedRoute.departureRunway.value_or("NONE") <<
 //             std::endl;
@@ -233,7 +234,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //     auto parsedRoute = handler.GetParser()->ParseRawRoute("ETREK UN854 LOGNI DCT MOKIP DCT ARFOZ UN854 TINIL ", "KMCO", "LFPG");
 //      std::cout << "Route: " << parsedRoute.rawRoute << std::endl;
 //
-//    if (parsedRoute.suggestedSTAR.has_value()) {
+//    if (parsedRoute.suggestedSTAR != nullptr) {
 //        std::cout << "Suggested STAR: " << parsedRoute.suggestedSTAR->name
 //            << " for runway " << parsedRoute.suggestedArrivalRunway.value_or("NONE") <<
 //            std::endl;
@@ -246,7 +247,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //         }*/
 //    }
 //
-//    if (parsedRoute.STAR.has_value()) {
+//    if (parsedRoute.STAR != nullptr) {
 //        std::cout << "Actual STAR: " << parsedRoute.STAR->name
 //            << " for runway " << parsedRoute.arrivalRunway.value_or("NONE") <<
 //            std::endl;
@@ -266,7 +267,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //         "SOBRA2L/18 SOBRA Y180 DIK UN857 TOLVU/N0356F230 UN857 RAPOR/N0363F240 UZ157 VEDUS", "KLAX", "LFPG");
 //     std::cout << "Route: " << parsedRoute.rawRoute << std::endl;
 //
-//     if (parsedRoute.suggestedSTAR.has_value()) {
+//     if (parsedRoute.suggestedSTAR != nullptr) {
 //         std::cout << "Suggested STAR: " << parsedRoute.suggestedSTAR->name
 //                   << " for runway " << parsedRoute.suggestedArrivalRunway.value_or("NONE")
 //                   << std::endl;
@@ -279,7 +280,7 @@ TEST_F(TestDataParserTests, TestDepartureRouteParsing) {
 //         }*/
 //     }
 //
-//     if (parsedRoute.STAR.has_value()) {
+//     if (parsedRoute.STAR != nullptr) {
 //         std::cout << "Actual STAR: " << parsedRoute.STAR->name << " for runway "
 //                   << parsedRoute.arrivalRunway.value_or("NONE") << std::endl;
 //